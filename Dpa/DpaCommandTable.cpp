@@ -0,0 +1,244 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaCommandTable.h"
+#include <cstddef>
+#include <cstring>
+
+namespace {
+  typedef DpaCommandTable::Entry Entry;
+  typedef DpaCommandTable::TimeoutClass TimeoutClass;
+
+  const int DPA_MAX = DPA_MAX_DATA_LENGTH;
+  const int FRC_EXTRARESULT_LENGTH = 9;
+  const int BITMAP_LENGTH = 32;
+  const int BACKUP_DATA_LENGTH = sizeof( TPerCoordinatorNodeBackup_Response );
+
+  const uint8_t IDEM = DpaCommandTable::kIdempotent;
+  const uint8_t FRC = DpaCommandTable::kFrc;
+  const uint8_t DISC = DpaCommandTable::kDiscovery;
+  const uint8_t BOND = DpaCommandTable::kBonding;
+
+  const TimeoutClass DEF = TimeoutClass::kDefault;
+  const TimeoutClass INF = TimeoutClass::kInfiniteAllowed;
+  const TimeoutClass BTO = TimeoutClass::kBond;
+
+#define DPA_CMD( pnum, pcmd, reqMin, reqMax, rspMin, rspMax, flags, timeoutClass, name ) \
+  { pnum, pcmd, reqMin, reqMax, rspMin, rspMax, flags, timeoutClass, name }
+
+#define DPA_MEMORY_CMDS( pnum, peripheral ) \
+  DPA_CMD( pnum, CMD_RAM_READ, 2, 2, 0, DPA_MAX, IDEM, DEF, "iqrfEmbed" peripheral "_Read" ), \
+  DPA_CMD( pnum, CMD_RAM_WRITE, 2, DPA_MAX, 0, 0, 0, DEF, "iqrfEmbed" peripheral "_Write" )
+
+#define DPA_LED_CMDS( pnum, led ) \
+  DPA_CMD( pnum, CMD_LED_SET_OFF, 0, 0, 0, 0, IDEM, DEF, "iqrfEmbedLed" led "_Set" ), \
+  DPA_CMD( pnum, CMD_LED_SET_ON, 0, 0, 0, 0, IDEM, DEF, "iqrfEmbedLed" led "_Set" ), \
+  DPA_CMD( pnum, CMD_LED_PULSE, 0, 0, 0, 0, 0, DEF, "iqrfEmbedLed" led "_Pulse" ), \
+  DPA_CMD( pnum, CMD_LED_FLASHING, 0, 0, 0, 0, 0, DEF, "iqrfEmbedLed" led "_Flashing" )
+
+  constexpr Entry ENTRIES[] = {
+    // Coordinator
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_ADDR_INFO, 0, 0, sizeof( TPerCoordinatorAddrInfo_Response ), sizeof( TPerCoordinatorAddrInfo_Response ),
+      IDEM, DEF, "iqrfEmbedCoordinator_AddrInfo" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_DISCOVERED_DEVICES, 0, 0, BITMAP_LENGTH, BITMAP_LENGTH,
+      IDEM, DEF, "iqrfEmbedCoordinator_DiscoveredDevices" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_BONDED_DEVICES, 0, 0, BITMAP_LENGTH, BITMAP_LENGTH,
+      IDEM, DEF, "iqrfEmbedCoordinator_BondedDevices" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_CLEAR_ALL_BONDS, 0, 0, 0, 0,
+      BOND, DEF, "iqrfEmbedCoordinator_ClearAllBonds" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_BOND_NODE, sizeof( TPerCoordinatorBondNode_Request ), sizeof( TPerCoordinatorBondNode_Request ),
+      sizeof( TPerCoordinatorBondNodeSmartConnect_Response ), sizeof( TPerCoordinatorBondNodeSmartConnect_Response ),
+      BOND, BTO, "iqrfEmbedCoordinator_BondNode" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_REMOVE_BOND, sizeof( TPerCoordinatorRemoveBond_Request ), sizeof( TPerCoordinatorRemoveBond_Request ),
+      sizeof( TPerCoordinatorRemoveBond_Response ), sizeof( TPerCoordinatorRemoveBond_Response ),
+      BOND, DEF, "iqrfEmbedCoordinator_RemoveBond" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_DISCOVERY, sizeof( TPerCoordinatorDiscovery_Request ), sizeof( TPerCoordinatorDiscovery_Request ),
+      sizeof( TPerCoordinatorDiscovery_Response ), sizeof( TPerCoordinatorDiscovery_Response ),
+      DISC, INF, "iqrfEmbedCoordinator_Discovery" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_SET_DPAPARAMS,
+      sizeof( TPerCoordinatorSetDpaParams_Request_Response ), sizeof( TPerCoordinatorSetDpaParams_Request_Response ),
+      sizeof( TPerCoordinatorSetDpaParams_Request_Response ), sizeof( TPerCoordinatorSetDpaParams_Request_Response ),
+      0, DEF, "iqrfEmbedCoordinator_SetDpaParams" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_SET_HOPS,
+      sizeof( TPerCoordinatorSetHops_Request_Response ), sizeof( TPerCoordinatorSetHops_Request_Response ),
+      sizeof( TPerCoordinatorSetHops_Request_Response ), sizeof( TPerCoordinatorSetHops_Request_Response ),
+      0, DEF, "iqrfEmbedCoordinator_SetHops" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_BACKUP, sizeof( TPerCoordinatorNodeBackup_Request ), sizeof( TPerCoordinatorNodeBackup_Request ),
+      BACKUP_DATA_LENGTH, BACKUP_DATA_LENGTH,
+      IDEM, DEF, "iqrfEmbedCoordinator_Backup" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_RESTORE, sizeof( TPerCoordinatorNodeRestore_Request ), sizeof( TPerCoordinatorNodeRestore_Request ),
+      0, 0, 0, DEF, "iqrfEmbedCoordinator_Restore" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_AUTHORIZE_BOND,
+      sizeof( TPerCoordinatorAuthorizeBond_Request ), sizeof( TPerCoordinatorAuthorizeBond_Request ),
+      sizeof( TPerCoordinatorAuthorizeBond_Response ), sizeof( TPerCoordinatorAuthorizeBond_Response ),
+      BOND, INF, "iqrfEmbedCoordinator_AuthorizeBond" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_BRIDGE, sizeof( TDpaIFaceHeader ), sizeof( TPerCoordinatorBridge_Request ),
+      0, sizeof( TPerCoordinatorBridge_Response ),
+      0, DEF, "iqrfEmbedCoordinator_Bridge" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_SMART_CONNECT,
+      sizeof( TPerCoordinatorSmartConnect_Request ), sizeof( TPerCoordinatorSmartConnect_Request ),
+      sizeof( TPerCoordinatorBondNodeSmartConnect_Response ), sizeof( TPerCoordinatorBondNodeSmartConnect_Response ),
+      BOND, INF, "iqrfEmbedCoordinator_SmartConnect" ),
+    DPA_CMD( PNUM_COORDINATOR, CMD_COORDINATOR_SET_MID, sizeof( TPerCoordinatorSetMID_Request ), sizeof( TPerCoordinatorSetMID_Request ),
+      0, 0, 0, DEF, "iqrfEmbedCoordinator_SetMID" ),
+
+    // Node
+    DPA_CMD( PNUM_NODE, CMD_NODE_READ, 0, 0, sizeof( TPerNodeRead_Response ), sizeof( TPerNodeRead_Response ),
+      IDEM, DEF, "iqrfEmbedNode_Read" ),
+    DPA_CMD( PNUM_NODE, CMD_NODE_REMOVE_BOND, 0, 0, 0, 0,
+      BOND, DEF, "iqrfEmbedNode_RemoveBond" ),
+    DPA_CMD( PNUM_NODE, CMD_NODE_BACKUP, sizeof( TPerCoordinatorNodeBackup_Request ), sizeof( TPerCoordinatorNodeBackup_Request ),
+      BACKUP_DATA_LENGTH, BACKUP_DATA_LENGTH,
+      IDEM, DEF, "iqrfEmbedNode_Backup" ),
+    DPA_CMD( PNUM_NODE, CMD_NODE_RESTORE, sizeof( TPerCoordinatorNodeRestore_Request ), sizeof( TPerCoordinatorNodeRestore_Request ),
+      0, 0, 0, DEF, "iqrfEmbedNode_Restore" ),
+    DPA_CMD( PNUM_NODE, CMD_NODE_VALIDATE_BONDS, sizeof( TPerNodeValidateBondsItem ), sizeof( TPerNodeValidateBonds_Request ),
+      0, 0, BOND, DEF, "iqrfEmbedNode_ValidateBonds" ),
+
+    // OS
+    DPA_CMD( PNUM_OS, CMD_OS_READ, 0, 0, offsetof( TPerOSRead_Response, UserPer ), sizeof( TPerOSRead_Response ),
+      IDEM, DEF, "iqrfEmbedOs_Read" ),
+    DPA_CMD( PNUM_OS, CMD_OS_RESET, 0, 0, 0, 0,
+      0, DEF, "iqrfEmbedOs_Reset" ),
+    DPA_CMD( PNUM_OS, CMD_OS_READ_CFG, 0, 0, offsetof( TPerOSReadCfg_Response, Undocumented ), sizeof( TPerOSReadCfg_Response ),
+      IDEM, DEF, "iqrfEmbedOs_ReadCfg" ),
+    DPA_CMD( PNUM_OS, CMD_OS_RFPGM, 0, 0, 0, 0,
+      0, DEF, "iqrfEmbedOs_Rfpgm" ),
+    DPA_CMD( PNUM_OS, CMD_OS_SLEEP, sizeof( TPerOSSleep_Request ), sizeof( TPerOSSleep_Request ), 0, 0,
+      0, DEF, "iqrfEmbedOs_Sleep" ),
+    DPA_CMD( PNUM_OS, CMD_OS_BATCH, 0, DPA_MAX, 0, 0,
+      0, DEF, "iqrfEmbedOs_Batch" ),
+    DPA_CMD( PNUM_OS, CMD_OS_SET_SECURITY, sizeof( TPerOSSetSecurity_Request ), sizeof( TPerOSSetSecurity_Request ), 0, 0,
+      0, DEF, "iqrfEmbedOs_SetSecurity" ),
+    DPA_CMD( PNUM_OS, CMD_OS_INDICATE, sizeof( TPerOSIndicate_Request ), sizeof( TPerOSIndicate_Request ), 0, 0,
+      0, DEF, "iqrfEmbedOs_Indicate" ),
+    DPA_CMD( PNUM_OS, CMD_OS_RESTART, 0, 0, 0, 0,
+      0, DEF, "iqrfEmbedOs_Restart" ),
+    DPA_CMD( PNUM_OS, CMD_OS_WRITE_CFG_BYTE, sizeof( TPerOSWriteCfgByteTriplet ), sizeof( TPerOSWriteCfgByte_Request ), 0, 0,
+      0, DEF, "iqrfEmbedOs_WriteCfgByte" ),
+    DPA_CMD( PNUM_OS, CMD_OS_LOAD_CODE, sizeof( TPerOSLoadCode_Request ), sizeof( TPerOSLoadCode_Request ), 1, 1,
+      0, DEF, "iqrfEmbedOs_LoadCode" ),
+    DPA_CMD( PNUM_OS, CMD_OS_SELECTIVE_BATCH, offsetof( TPerOSSelectiveBatch_Request, Requests ), sizeof( TPerOSSelectiveBatch_Request ), 0, 0,
+      0, DEF, "iqrfEmbedOs_SelectiveBatch" ),
+    DPA_CMD( PNUM_OS, CMD_OS_TEST_RF_SIGNAL, sizeof( TPerOSTestRfSignal_Request ), sizeof( TPerOSTestRfSignal_Request ),
+      sizeof( TPerOSTestRfSignal_Response ), sizeof( TPerOSTestRfSignal_Response ),
+      0, DEF, "iqrfEmbedOs_TestRfSignal" ),
+    DPA_CMD( PNUM_OS, CMD_OS_FACTORY_SETTINGS, 0, 0, 0, 0,
+      0, DEF, "iqrfEmbedOs_FactorySettings" ),
+    DPA_CMD( PNUM_OS, CMD_OS_WRITE_CFG, sizeof( TPerOSWriteCfg_Request ), sizeof( TPerOSWriteCfg_Request ), 0, 0,
+      0, DEF, "iqrfEmbedOs_WriteCfg" ),
+
+    // Memory
+    DPA_MEMORY_CMDS( PNUM_EEPROM, "Eeprom" ),
+    DPA_MEMORY_CMDS( PNUM_RAM, "Ram" ),
+    DPA_CMD( PNUM_EEEPROM, CMD_EEEPROM_XREAD, 3, 3, 0, DPA_MAX,
+      IDEM, DEF, "iqrfEmbedEeeprom_Read" ),
+    DPA_CMD( PNUM_EEEPROM, CMD_EEEPROM_XWRITE, 3, DPA_MAX, 0, 0,
+      0, DEF, "iqrfEmbedEeeprom_Write" ),
+
+    // LEDs
+    DPA_LED_CMDS( PNUM_LEDR, "r" ),
+    DPA_LED_CMDS( PNUM_LEDG, "g" ),
+
+    // IO
+    DPA_CMD( PNUM_IO, CMD_IO_DIRECTION, sizeof( TPerIOTriplet ), DPA_MAX, 0, 0,
+      IDEM, DEF, "iqrfEmbedIo_Direction" ),
+    DPA_CMD( PNUM_IO, CMD_IO_SET, sizeof( TPerIOTriplet ), DPA_MAX, 0, 0,
+      0, DEF, "iqrfEmbedIo_Set" ),
+    DPA_CMD( PNUM_IO, CMD_IO_GET, 0, 0, 0, DPA_MAX,
+      IDEM, DEF, "iqrfEmbedIo_Get" ),
+
+    // Thermometer
+    DPA_CMD( PNUM_THERMOMETER, CMD_THERMOMETER_READ, 0, 0,
+      sizeof( TPerThermometerRead_Response ), sizeof( TPerThermometerRead_Response ),
+      IDEM, DEF, "iqrfEmbedThermometer_Read" ),
+
+    // UART
+    DPA_CMD( PNUM_UART, CMD_UART_OPEN, sizeof( TPerUartOpen_Request ), sizeof( TPerUartOpen_Request ), 0, 0,
+      0, DEF, "iqrfEmbedUart_Open" ),
+    DPA_CMD( PNUM_UART, CMD_UART_CLOSE, 0, 0, 0, 0,
+      0, DEF, "iqrfEmbedUart_Close" ),
+    DPA_CMD( PNUM_UART, CMD_UART_WRITE_READ, offsetof( TPerUartWriteRead_Request, WrittenData ), sizeof( TPerUartWriteRead_Request ), 0, DPA_MAX,
+      0, DEF, "iqrfEmbedUart_WriteRead" ),
+    DPA_CMD( PNUM_UART, CMD_UART_CLEAR_WRITE_READ, offsetof( TPerUartWriteRead_Request, WrittenData ), sizeof( TPerUartWriteRead_Request ), 0, DPA_MAX,
+      0, DEF, "iqrfEmbedUart_ClearWriteRead" ),
+
+    // FRC
+    DPA_CMD( PNUM_FRC, CMD_FRC_SEND, offsetof( TPerFrcSend_Request, UserData ), sizeof( TPerFrcSend_Request ),
+      sizeof( TPerFrcSend_Response ), sizeof( TPerFrcSend_Response ),
+      FRC, INF, "iqrfEmbedFrc_Send" ),
+    DPA_CMD( PNUM_FRC, CMD_FRC_EXTRARESULT, 0, 0, FRC_EXTRARESULT_LENGTH, FRC_EXTRARESULT_LENGTH,
+      FRC | IDEM, DEF, "iqrfEmbedFrc_ExtraResult" ),
+    DPA_CMD( PNUM_FRC, CMD_FRC_SEND_SELECTIVE, offsetof( TPerFrcSendSelective_Request, UserData ), sizeof( TPerFrcSendSelective_Request ),
+      sizeof( TPerFrcSend_Response ), sizeof( TPerFrcSend_Response ),
+      FRC, INF, "iqrfEmbedFrc_SendSelective" ),
+    DPA_CMD( PNUM_FRC, CMD_FRC_SET_PARAMS,
+      sizeof( TPerFrcSetParams_RequestResponse ), sizeof( TPerFrcSetParams_RequestResponse ),
+      sizeof( TPerFrcSetParams_RequestResponse ), sizeof( TPerFrcSetParams_RequestResponse ),
+      FRC, DEF, "iqrfEmbedFrc_SetParams" ),
+  };
+
+  // common commands out of the indexed table
+  constexpr Entry GET_PER_INFO = DPA_CMD( 0, CMD_GET_PER_INFO, 0, 0,
+    sizeof( TPeripheralInfoAnswer ), sizeof( TPeripheralInfoAnswer ), IDEM, DEF, "iqrfEmbedExplore_PeripheralInformation" );
+  constexpr Entry ENUMERATION = DPA_CMD( PNUM_ENUMERATION, CMD_GET_PER_INFO, 0, 0,
+    offsetof( TEnumPeripheralsAnswer, UserPer ), sizeof( TEnumPeripheralsAnswer ), IDEM, DEF, "iqrfEmbedExplore_Enumerate" );
+
+#undef DPA_LED_CMDS
+#undef DPA_MEMORY_CMDS
+#undef DPA_CMD
+
+  const int ENTRIES_COUNT = static_cast<int>( sizeof( ENTRIES ) / sizeof( ENTRIES[0] ) );
+  static_assert( sizeof( ENTRIES ) / sizeof( ENTRIES[0] ) < 0xff, "Index type too small." );
+
+  // (PNUM, PCMD) index to ENTRIES, 0 is unknown command, otherwise position + 1
+  struct Index {
+    uint8_t table[DpaCommandTable::TABLE_SIZE][DpaCommandTable::TABLE_SIZE];
+
+    Index()
+    {
+      std::memset( table, 0, sizeof( table ) );
+      for ( int i = 0; i < ENTRIES_COUNT; i++ ) {
+        table[ENTRIES[i].pnum][ENTRIES[i].pcmd] = static_cast<uint8_t>( i + 1 );
+      }
+    }
+  };
+}
+
+const DpaCommandTable::Entry* DpaCommandTable::get( uint8_t pnum, uint8_t pcmd )
+{
+  // thread safe initialization of the index at the first call
+  static const Index index;
+
+  pcmd &= ~0x80;
+
+  if ( pcmd == CMD_GET_PER_INFO ) {
+    return pnum == PNUM_ENUMERATION ? &ENUMERATION : &GET_PER_INFO;
+  }
+  if ( pnum >= TABLE_SIZE ) {
+    return nullptr;
+  }
+
+  uint8_t position = index.table[pnum][pcmd];
+  return position != 0 ? &ENTRIES[position - 1] : nullptr;
+}
+
+const DpaCommandTable::Entry* DpaCommandTable::entries( int& count )
+{
+  count = ENTRIES_COUNT;
+  return ENTRIES;
+}
@@ -0,0 +1,100 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "DPA.h"
+#ifdef __cplusplus
+}
+#endif
+
+/// \class DpaCommandTable
+/// \brief Metadata of DPA commands indexed by peripheral number and command
+/// \details
+/// The entries are a constexpr list derived from the structures of DPA.h. The list is indexed
+/// to a 128 x 128 (PNUM, PCMD) table at the first lookup, so getting metadata of a command
+/// is a single table access. CMD_GET_PER_INFO is common for all peripherals and the peripheral
+/// enumeration (PNUM_ENUMERATION) is out of the table range, both are handled by get() as well.
+///
+/// Lengths are PData lengths, i.e. request without foursome and HWPID, response without
+/// foursome, HWPID, ResponseCode and DpaValue.
+class DpaCommandTable
+{
+public:
+  /// command properties
+  enum Flags {
+    kNone = 0x00,
+    /// FRC command
+    kFrc = 0x01,
+    /// network discovery
+    kDiscovery = 0x02,
+    /// bonding of nodes
+    kBonding = 0x04,
+    /// command without side effect, it can be repeated safely
+    kIdempotent = 0x08
+  };
+
+  /// timeout handling of the command when addressed to coordinator
+  enum class TimeoutClass {
+    /// user timeout checked against the default timeout
+    kDefault,
+    /// infinite timeout allowed (INFINITE_TIMEOUT or negative user timeout)
+    kInfiniteAllowed,
+    /// BOND_TIMEOUT_MS used if user doesn't specify timeout
+    kBond
+  };
+
+  /// metadata of a command
+  struct Entry {
+    uint8_t pnum;
+    uint8_t pcmd;
+    uint8_t requestMin;
+    uint8_t requestMax;
+    uint8_t responseMin;
+    uint8_t responseMax;
+    uint8_t flags;
+    TimeoutClass timeoutClass;
+    /// name of the command used in JSON and logs
+    const char* name;
+
+    bool isFrc() const { return ( flags & kFrc ) != 0; }
+    bool isDiscovery() const { return ( flags & kDiscovery ) != 0; }
+    bool isBonding() const { return ( flags & kBonding ) != 0; }
+    bool isIdempotent() const { return ( flags & kIdempotent ) != 0; }
+    bool isValidRequestLength( int length ) const { return length >= requestMin && length <= requestMax; }
+    bool isValidResponseLength( int length ) const { return length >= responseMin && length <= responseMax; }
+  };
+
+  /// number of peripherals and commands in the index
+  static const int TABLE_SIZE = 128;
+
+  /// \brief Get metadata of a command
+  /// \param [in] pnum peripheral number
+  /// \param [in] pcmd peripheral command, response flag 0x80 is ignored
+  /// \return metadata or nullptr for unknown (e.g. user peripheral) command
+  static const Entry* get( uint8_t pnum, uint8_t pcmd );
+
+  /// \brief Get all known commands
+  /// \param [out] count number of entries
+  /// \return pointer to the first entry
+  static const Entry* entries( int& count );
+};
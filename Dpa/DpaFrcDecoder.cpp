@@ -0,0 +1,238 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaFrcDecoder.h"
+#include "DpaResponse.h"
+#include "DpaEndian.h"
+#include <algorithm>
+#include <cstring>
+
+// SIMD kernel selection, DPA_FRC_NO_SIMD forces the scalar implementation.
+#if !defined( DPA_FRC_NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define DPA_FRC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // bytes of bit planes of 2 bits FRC data
+  const int PLANE_LENGTH = 30;
+  // offset of bit 1 plane of 2 bits FRC data
+  const int PLANE1_OFFSET = 32;
+
+  // number of nodes with both bits received
+  int complete2BitNodes( int dataLength )
+  {
+    int plane0 = std::min( std::max( dataLength, 0 ), PLANE_LENGTH );
+    int plane1 = std::min( std::max( dataLength - PLANE1_OFFSET, 0 ), PLANE_LENGTH );
+    return std::min( plane0, plane1 ) * 8;
+  }
+
+  // copy of received FRC data zero padded to full length
+  void padData( const uint8_t* data, int dataLength, uint8_t( &padded )[DpaFrcDecoder::FRC_DATA_LENGTH] )
+  {
+    int len = std::min( std::max( dataLength, 0 ), static_cast<int>( DpaFrcDecoder::FRC_DATA_LENGTH ) );
+    if ( len > 0 ) {
+      std::memcpy( padded, data, len );
+    }
+    std::memset( padded + len, 0, DpaFrcDecoder::FRC_DATA_LENGTH - len );
+  }
+}
+
+DpaFrcDecoder::DataWidth DpaFrcDecoder::getDataWidth( uint8_t frcCommand )
+{
+  if ( frcCommand < 0x80 ) {
+    return DataWidth::k2Bit;
+  }
+  else if ( frcCommand < 0xE0 ) {
+    return DataWidth::k1Byte;
+  }
+  else if ( frcCommand < 0xF8 ) {
+    return DataWidth::k2Byte;
+  }
+  return DataWidth::k4Byte;
+}
+
+int DpaFrcDecoder::getMaxValues( DataWidth width )
+{
+  switch ( width ) {
+    case DataWidth::k2Bit:
+      return MAX_NODES;
+    case DataWidth::k1Byte:
+      return FRC_DATA_LENGTH;
+    case DataWidth::k2Byte:
+      return FRC_DATA_LENGTH / 2;
+    case DataWidth::k4Byte:
+    default:
+      return FRC_DATA_LENGTH / 4;
+  }
+}
+
+int DpaFrcDecoder::collectData( const IDpaTransactionResult2& frcSend, const IDpaTransactionResult2* extraResult,
+  uint8_t( &data )[FRC_DATA_LENGTH] )
+{
+  DpaResponseView<TPerFrcSend_Response> sendResponse( frcSend );
+  std::memcpy( data, sendResponse->FrcData, FRC_SEND_DATA_LENGTH );
+  std::memset( data + FRC_SEND_DATA_LENGTH, 0, FRC_EXTRARESULT_DATA_LENGTH );
+  int len = FRC_SEND_DATA_LENGTH;
+
+  if ( extraResult != nullptr ) {
+    DpaResponseView<uint8_t> extraResponse( *extraResult );
+    int extraLen = std::min( extraResponse.DataLength(), static_cast<int>( FRC_EXTRARESULT_DATA_LENGTH ) );
+    std::memcpy( data + FRC_SEND_DATA_LENGTH, &*extraResponse, extraLen );
+    len += extraLen;
+  }
+
+  return len;
+}
+
+int DpaFrcDecoder::unpack( uint8_t frcCommand, const uint8_t* data, int dataLength, uint32_t* values, int maxValues )
+{
+  int count = 0;
+  int decoded = 0;
+
+  switch ( getDataWidth( frcCommand ) ) {
+    case DataWidth::k2Bit:
+    {
+      uint8_t v[MAX_NODES];
+      decoded = unpack2Bit( data, dataLength, v );
+      count = std::min( maxValues, static_cast<int>( MAX_NODES ) );
+      std::copy( v, v + count, values );
+      break;
+    }
+    case DataWidth::k1Byte:
+    {
+      uint8_t v[FRC_DATA_LENGTH];
+      decoded = unpack1Byte( data, dataLength, v );
+      count = std::min( maxValues, static_cast<int>( FRC_DATA_LENGTH ) );
+      std::copy( v, v + count, values );
+      break;
+    }
+    case DataWidth::k2Byte:
+    {
+      uint16_t v[FRC_DATA_LENGTH / 2];
+      decoded = unpack2Byte( data, dataLength, v );
+      count = std::min( maxValues, static_cast<int>( FRC_DATA_LENGTH / 2 ) );
+      std::copy( v, v + count, values );
+      break;
+    }
+    case DataWidth::k4Byte:
+    {
+      uint32_t v[FRC_DATA_LENGTH / 4];
+      decoded = unpack4Byte( data, dataLength, v );
+      count = std::min( maxValues, static_cast<int>( FRC_DATA_LENGTH / 4 ) );
+      std::copy( v, v + count, values );
+      break;
+    }
+  }
+
+  return std::min( decoded, count );
+}
+
+int DpaFrcDecoder::unpack2BitScalar( const uint8_t* data, int dataLength, uint8_t( &values )[MAX_NODES] )
+{
+  uint8_t padded[FRC_DATA_LENGTH];
+  padData( data, dataLength, padded );
+
+  for ( int node = 0; node < MAX_NODES; node++ ) {
+    uint8_t bit0 = ( padded[node / 8] >> ( node % 8 ) ) & 0x01;
+    uint8_t bit1 = ( padded[PLANE1_OFFSET + node / 8] >> ( node % 8 ) ) & 0x01;
+    values[node] = static_cast<uint8_t>( bit0 | ( bit1 << 1 ) );
+  }
+
+  return complete2BitNodes( dataLength );
+}
+
+int DpaFrcDecoder::unpack2Bit( const uint8_t* data, int dataLength, uint8_t( &values )[MAX_NODES] )
+{
+#if defined( DPA_FRC_SSE2 )
+  uint8_t padded[FRC_DATA_LENGTH];
+  padData( data, dataLength, padded );
+
+  // each input byte is spread to 8 lanes and tested by its bit mask
+  const __m128i mask = _mm_set_epi8( -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1 );
+  const __m128i one = _mm_set1_epi8( 1 );
+  const __m128i two = _mm_set1_epi8( 2 );
+
+  // 2 x 16 bytes of each plane gives 256 values, the last 16 are out of the address space
+  uint8_t out[256];
+
+  for ( int chunk = 0; chunk < 2; chunk++ ) {
+    __m128i planes[2] = {
+      _mm_loadu_si128( reinterpret_cast<const __m128i*>( padded + chunk * 16 ) ),
+      _mm_loadu_si128( reinterpret_cast<const __m128i*>( padded + PLANE1_OFFSET + chunk * 16 ) )
+    };
+    __m128i spread[2][8];
+
+    for ( int p = 0; p < 2; p++ ) {
+      __m128i lo = _mm_unpacklo_epi8( planes[p], planes[p] );
+      __m128i hi = _mm_unpackhi_epi8( planes[p], planes[p] );
+      __m128i q[4] = {
+        _mm_unpacklo_epi16( lo, lo ),
+        _mm_unpackhi_epi16( lo, lo ),
+        _mm_unpacklo_epi16( hi, hi ),
+        _mm_unpackhi_epi16( hi, hi )
+      };
+      for ( int i = 0; i < 4; i++ ) {
+        spread[p][2 * i] = _mm_unpacklo_epi32( q[i], q[i] );
+        spread[p][2 * i + 1] = _mm_unpackhi_epi32( q[i], q[i] );
+      }
+    }
+
+    for ( int i = 0; i < 8; i++ ) {
+      __m128i bit0 = _mm_and_si128( _mm_cmpeq_epi8( _mm_and_si128( spread[0][i], mask ), mask ), one );
+      __m128i bit1 = _mm_and_si128( _mm_cmpeq_epi8( _mm_and_si128( spread[1][i], mask ), mask ), two );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( out + chunk * 128 + i * 16 ), _mm_or_si128( bit0, bit1 ) );
+    }
+  }
+
+  std::memcpy( values, out, MAX_NODES );
+  return complete2BitNodes( dataLength );
+
+#else
+  return unpack2BitScalar( data, dataLength, values );
+#endif
+}
+
+int DpaFrcDecoder::unpack1Byte( const uint8_t* data, int dataLength, uint8_t( &values )[FRC_DATA_LENGTH] )
+{
+  padData( data, dataLength, values );
+  return std::min( std::max( dataLength, 0 ), static_cast<int>( FRC_DATA_LENGTH ) );
+}
+
+int DpaFrcDecoder::unpack2Byte( const uint8_t* data, int dataLength, uint16_t( &values )[FRC_DATA_LENGTH / 2] )
+{
+  uint8_t padded[FRC_DATA_LENGTH];
+  padData( data, dataLength, padded );
+
+  for ( int i = 0; i < FRC_DATA_LENGTH / 2; i++ ) {
+    values[i] = DpaEndian::loadLe16( padded + 2 * i );
+  }
+
+  return std::min( std::max( dataLength, 0 ), static_cast<int>( FRC_DATA_LENGTH ) ) / 2;
+}
+
+int DpaFrcDecoder::unpack4Byte( const uint8_t* data, int dataLength, uint32_t( &values )[FRC_DATA_LENGTH / 4] )
+{
+  uint8_t padded[FRC_DATA_LENGTH];
+  padData( data, dataLength, padded );
+
+  for ( int i = 0; i < FRC_DATA_LENGTH / 4; i++ ) {
+    values[i] = DpaEndian::loadLe32( padded + 4 * i );
+  }
+
+  return std::min( std::max( dataLength, 0 ), static_cast<int>( FRC_DATA_LENGTH ) ) / 4;
+}
@@ -0,0 +1,97 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "IDpaTransactionResult2.h"
+#include <cstdint>
+
+/// \class DpaFrcDecoder
+/// \brief Unpacks FRC data to dense per node arrays
+/// \details
+/// FRC data are the FrcData of CMD_FRC_SEND (CMD_FRC_SEND_SELECTIVE) response followed by the data of
+/// CMD_FRC_EXTRARESULT response, 64 bytes in total. The width of per node value is given by FRC command:
+/// - 0x00 - 0x7F 2 bits, bit 0 of node N at bit N of bytes 0 - 29, bit 1 at bit N of bytes 32 - 61
+/// - 0x80 - 0xDF 1 byte, node N at byte N
+/// - 0xE0 - 0xF7 2 bytes, node N at bytes 2N, 2N + 1 (little endian)
+/// - 0xF8 - 0xFF 4 bytes, node N at bytes 4N - 4N + 3 (little endian)
+///
+/// Values are indexed by node address, index 0 belongs to coordinator. Missing data (e.g. extra result
+/// was not read) are handled as zero and the functions return number of values decoded from received data.
+/// The 2 bits layout is unpacked by SSE2 kernel if available, by the scalar loop elsewhere,
+/// DpaBenchmarks/FrcDecoderBenchmark compares it with the scalar loop. Wider values are little endian
+/// in the buffer so they are loaded by DpaEndian which is a plain copy at little endian host.
+class DpaFrcDecoder
+{
+public:
+  /// width of per node FRC value
+  enum class DataWidth {
+    k2Bit,
+    k1Byte,
+    k2Byte,
+    k4Byte
+  };
+
+  /// number of FRC data bytes of FRC send and extra result together
+  static const int FRC_DATA_LENGTH = 64;
+  /// number of FRC data bytes in FRC send response
+  static const int FRC_SEND_DATA_LENGTH = 55;
+  /// number of FRC data bytes in FRC extra result response
+  static const int FRC_EXTRARESULT_DATA_LENGTH = FRC_DATA_LENGTH - FRC_SEND_DATA_LENGTH;
+  /// maximal number of nodes (addresses) in FRC 2 bits result
+  static const int MAX_NODES = MAX_ADDRESS + 1;
+
+  /// \brief Get width of per node value
+  /// \param [in] frcCommand FRC command
+  /// \return value width
+  static DataWidth getDataWidth( uint8_t frcCommand );
+
+  /// \brief Get number of values in FRC data
+  /// \param [in] width value width
+  /// \return number of values in whole FRC data (send and extra result)
+  static int getMaxValues( DataWidth width );
+
+  /// \brief Collect FRC data from FRC send and extra result responses
+  /// \param [in] frcSend result of CMD_FRC_SEND or CMD_FRC_SEND_SELECTIVE transaction
+  /// \param [in] extraResult result of CMD_FRC_EXTRARESULT transaction, can be nullptr
+  /// \param [out] data FRC data
+  /// \return number of valid bytes in data, the rest is zeroed
+  /// \exception std::logic_error or std::length_error when a transaction has no valid response
+  static int collectData( const IDpaTransactionResult2& frcSend, const IDpaTransactionResult2* extraResult,
+    uint8_t( &data )[FRC_DATA_LENGTH] );
+
+  /// \brief Unpack FRC data of any FRC command
+  /// \param [in] frcCommand FRC command given by width of values
+  /// \param [in] data FRC data
+  /// \param [in] dataLength length of FRC data
+  /// \param [out] values unpacked values indexed by node address
+  /// \param [in] maxValues size of values array
+  /// \return number of values decoded from received data
+  static int unpack( uint8_t frcCommand, const uint8_t* data, int dataLength, uint32_t* values, int maxValues );
+
+  /// \brief Unpack 2 bits FRC data
+  /// \param [out] values MAX_NODES values 0 - 3 indexed by node address
+  static int unpack2Bit( const uint8_t* data, int dataLength, uint8_t( &values )[MAX_NODES] );
+  /// \brief Unpack 2 bits FRC data, scalar implementation used as fallback and reference
+  static int unpack2BitScalar( const uint8_t* data, int dataLength, uint8_t( &values )[MAX_NODES] );
+  /// \brief Unpack 1 byte FRC data
+  static int unpack1Byte( const uint8_t* data, int dataLength, uint8_t( &values )[FRC_DATA_LENGTH] );
+  /// \brief Unpack 2 bytes FRC data
+  static int unpack2Byte( const uint8_t* data, int dataLength, uint16_t( &values )[FRC_DATA_LENGTH / 2] );
+  /// \brief Unpack 4 bytes FRC data
+  static int unpack4Byte( const uint8_t* data, int dataLength, uint32_t( &values )[FRC_DATA_LENGTH / 4] );
+};
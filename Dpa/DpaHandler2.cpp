@@ -18,15 +18,24 @@
 #include "TaskQueue.h"
 #include "DpaHandler2.h"
 #include "DpaTransaction2.h"
+#include "DpaTimeoutEstimator.h"
+#include "DpaTimerWheel.h"
+#include "DpaPool.h"
 #include "DpaTransactionResult2.h"
 #include "DpaMessage.h"
+#include "DpaMessageView.h"
 #include "IqrfTrace.h"
 #include "IqrfTraceHex.h"
 #include "IChannel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <exception>
 #include <future>
 #include <map>
 #include <utility>
+#include <vector>
 
 /////////////////////////////////////
 // class DpaHandler2::Imp
@@ -41,21 +50,28 @@ public:
     :m_iqrfInterface( iqrfInterface )
   {
     m_dpaTransactionQueue = ant_new TaskQueue<std::shared_ptr<DpaTransaction2>>( [&]( std::shared_ptr<DpaTransaction2> ptr ) {
-      m_pendingTransaction = ptr;
-      size_t size = m_dpaTransactionQueue->size();
-      if ( size < QUEUE_MAX_LEN ) {
-        m_pendingTransaction->execute(); // succesfully queued
-      }
-      else {
-        TRC_ERROR( "Transaction queue overload: " << PAR( size ) );
-        m_pendingTransaction->execute(IDpaTransactionResult2::TRN_ERROR_IFACE_QUEUE_FULL);  // queue full transaction not handled, error reported
+      size_t size = dequeued( ptr );
+      {
+        // waits for a transaction executed inline by a submitting thread
+        std::lock_guard<std::mutex> lck( m_executeMutex );
+        m_pendingTransaction = ptr;
+        if ( ptr->isBatched() || size < QUEUE_MAX_LEN ) {
+          m_pendingTransaction->execute(); // succesfully queued
+        }
+        else {
+          TRC_ERROR( "Transaction queue overload: " << PAR( size ) );
+          m_pendingTransaction->execute(IDpaTransactionResult2::TRN_ERROR_IFACE_QUEUE_FULL);  // queue full transaction not handled, error reported
+        }
       }
+      executed();
+      updateLiveness( ptr->getNodeAddress(), ptr->getErrorCode() );
     } );
 
     if ( iqrfInterface == nullptr ) {
       throw std::invalid_argument( "DPA interface argument can not be nullptr." );
     }
     m_iqrfInterface = iqrfInterface;
+    m_sendBuffer.reserve( DpaMessage::kMaxDpaMessageSize );
 
     // register callback for cdc or spi interface
     m_iqrfInterface->registerReceiveFromHandler( [&]( const std::basic_string<unsigned char>& msg ) -> int {
@@ -64,20 +80,27 @@ public:
     } );
 
     // initialize m_FrcTimingParams 
-    m_timingParams.bondedNodes = 1;
-    m_timingParams.discoveredNodes = 1;
-    m_timingParams.osVersion = "4.02D";
-    m_timingParams.dpaVersion = 0x0302;
-    m_timingParams.frcResponseTime = IDpaTransaction2::FrcResponseTime::k40Ms;
+    IDpaTransaction2::TimingParams params;
+    params.bondedNodes = 1;
+    params.discoveredNodes = 1;
+    params.osVersion = "4.02D";
+    params.dpaVersion = 0x0302;
+    params.frcResponseTime = IDpaTransaction2::FrcResponseTime::k40Ms;
+    setTimingParams( params );
   }
 
   ~Imp()
   {
+    m_dpaTransactionQueue->stopQueue();
     // kill DpaTransaction if any
     if ( m_pendingTransaction ) {
       m_pendingTransaction->abort();
     }
-    m_dpaTransactionQueue->stopQueue();
+    // no timer calls the handler from now, retries waiting for backoff are dropped
+    m_timerWheel->stop();
+    for ( const auto& ptr : m_backoffRetries ) {
+      ptr->dropBackoff();
+    }
     delete m_dpaTransactionQueue;
   }
 
@@ -86,64 +109,330 @@ public:
     if ( message.length() == 0 )
       return;
 
+    count( kReceived );
+
     TRC_INFORMATION( ">>>>>>>>>>>>>>>>>>" << std::endl <<
              "Received from IQRF interface: " << std::endl << MEM_HEX( message.data(), message.length() ) );
 
-    // incoming message
-    DpaMessage receivedMessage;
-    try {
-      receivedMessage.FillFromResponse( message.data(), static_cast<uint8_t>(message.length()) );
-    }
-    catch ( std::exception& e ) {
-      CATCH_EXC_TRC_WAR(std::exception, e, "in processing msg");
+    if ( message.length() > static_cast<size_t>( DpaMessage::kMaxDpaMessageSize ) ) {
+      TRC_WARNING( "in processing msg: Not enough space for this data." << PAR( message.length() ) );
+      count( kTooLong );
       return;
     }
 
+    // incoming message, just a view over the received data, copied only when kept
+    DpaMessageView receivedMessage( message );
+
     // process any message handler for special handling before transaction processig
     processAnyMessage(receivedMessage);
 
     auto messageDirection = receivedMessage.MessageDirection();
+    TErrorCodes responseCode = STATUS_NO_ERROR;
     if ( messageDirection == DpaMessage::MessageType::kRequest ) {
       //Always Async
-      processAsynchronousMessage( message );
+      count( kAsynchronous );
+      processAsynchronousMessage( receivedMessage );
       return;
     }
-    else if ( messageDirection == DpaMessage::MessageType::kResponse &&
-              receivedMessage.DpaPacket().DpaResponsePacket_t.ResponseCode & STATUS_ASYNC_RESPONSE ) {
+    else if ( receivedMessage.TryResponseCode( responseCode ) && ( responseCode & STATUS_ASYNC_RESPONSE ) ) {
       // async msg
-      processAsynchronousMessage( message );
+      count( kAsynchronous );
+      processAsynchronousMessage( receivedMessage );
       return;
     }
+    else if ( !m_pendingTransaction ) {
+      TRC_WARNING( "No pending transaction for received message" );
+      count( kNoPendingTransaction );
+    }
     else {
-      try {
-        m_pendingTransaction->processReceivedMessage( message );
+      DpaTransaction2::MatchResult result = m_pendingTransaction->tryProcessReceivedMessage( receivedMessage );
+      switch ( result ) {
+        case DpaTransaction2::MatchResult::kMatched:
+          count( kMatched );
+          break;
+        case DpaTransaction2::MatchResult::kFinished:
+          count( kAfterFinish );
+          break;
+        case DpaTransaction2::MatchResult::kNotResponse:
+          count( kNotResponse );
+          break;
+        case DpaTransaction2::MatchResult::kNodeAddressMismatch:
+          count( kNodeAddressMismatch );
+          break;
+        case DpaTransaction2::MatchResult::kPeripheralTypeMismatch:
+          count( kPeripheralTypeMismatch );
+          break;
+        case DpaTransaction2::MatchResult::kPeripheralCommandMismatch:
+          count( kPeripheralCommandMismatch );
+          break;
       }
-      catch ( std::logic_error& le ) {
-        CATCH_EXC_TRC_WAR(std::logic_error, le, "Process received message error..." );
+      if ( result != DpaTransaction2::MatchResult::kMatched && result != DpaTransaction2::MatchResult::kFinished ) {
+        TRC_WARNING( "Received message doesn't match pending transaction: " << PAR( static_cast<int>( result ) ) );
       }
     }
   }
 
+  IDpaHandler2::ReceiveStats getReceiveStats() const
+  {
+    IDpaHandler2::ReceiveStats stats;
+    stats.received = m_receiveCounters[kReceived].load( std::memory_order_relaxed );
+    stats.tooLong = m_receiveCounters[kTooLong].load( std::memory_order_relaxed );
+    stats.asynchronous = m_receiveCounters[kAsynchronous].load( std::memory_order_relaxed );
+    stats.matched = m_receiveCounters[kMatched].load( std::memory_order_relaxed );
+    stats.noPendingTransaction = m_receiveCounters[kNoPendingTransaction].load( std::memory_order_relaxed );
+    stats.afterFinish = m_receiveCounters[kAfterFinish].load( std::memory_order_relaxed );
+    stats.notResponse = m_receiveCounters[kNotResponse].load( std::memory_order_relaxed );
+    stats.nodeAddressMismatch = m_receiveCounters[kNodeAddressMismatch].load( std::memory_order_relaxed );
+    stats.peripheralTypeMismatch = m_receiveCounters[kPeripheralTypeMismatch].load( std::memory_order_relaxed );
+    stats.peripheralCommandMismatch = m_receiveCounters[kPeripheralCommandMismatch].load( std::memory_order_relaxed );
+    return stats;
+  }
+
+  void setAdaptiveTimeout( bool enable )
+  {
+    m_adaptiveTimeout = enable;
+  }
+
+  bool getAdaptiveTimeout() const
+  {
+    return m_adaptiveTimeout;
+  }
+
+  std::map<uint16_t, IDpaHandler2::TimeoutStats> getNodeTimeoutStats() const
+  {
+    return m_timeoutEstimator->getNodeStats();
+  }
+
+  std::map<uint8_t, IDpaHandler2::TimeoutStats> getHopsTimeoutStats() const
+  {
+    return m_timeoutEstimator->getHopsStats();
+  }
+
+  void resetTimeoutStats()
+  {
+    m_timeoutEstimator->reset();
+  }
+
+  void setReleaseResultOnResponse( bool enable )
+  {
+    m_releaseResultOnResponse = enable;
+  }
+
+  bool getReleaseResultOnResponse() const
+  {
+    return m_releaseResultOnResponse;
+  }
+
+  void setInlineExecution( bool enable )
+  {
+    m_inlineExecution = enable;
+  }
+
+  bool getInlineExecution() const
+  {
+    return m_inlineExecution;
+  }
+
   std::shared_ptr<IDpaTransaction2> executeDpaTransaction( const DpaMessage& request, int32_t timeout, 
     IDpaTransactionResult2::ErrorCode defaultError)
   {
-    if ( request.GetLength() <= 0 ) {
-      //TODO gets stuck on DpaTransaction2::get() if processed here
-      TRC_WARNING( "Empty request => nothing to sent and transaction aborted" );
-      std::shared_ptr<DpaTransaction2> ptr( ant_new DpaTransaction2( request, m_rfMode, m_timingParams, m_defaultTimeout, timeout, nullptr, defaultError ) );
+    IDpaHandler2::TransactionOptions options;
+    options.timeout = timeout;
+    options.defaultError = defaultError;
+    return executeDpaTransaction( request, options );
+  }
+
+  std::shared_ptr<IDpaTransaction2> executeDpaTransaction( const DpaMessage& request, const IDpaHandler2::TransactionOptions& options )
+  {
+    if ( options.retry.maxAttempts > 1 ) {
+      return startRetry( request, options, nullptr );
+    }
+    std::shared_ptr<DpaTransaction2> ptr = createTransaction( request, options );
+    if ( m_inlineExecution && executeInline( ptr, request, options.deadline ) ) {
       return ptr;
     }
-    std::shared_ptr<DpaTransaction2> ptr( ant_new DpaTransaction2( request,
-      m_rfMode, m_timingParams, m_defaultTimeout, timeout,
-      [&]( const DpaMessage& r ) {
-        sendRequest( r );
-      },
-      defaultError
-    ));
-    m_dpaTransactionQueue->pushToQueue( ptr );
+    queueTransaction( ptr, request, options.deadline );
     return ptr;
   }
 
+  std::shared_ptr<IDpaTransaction2> executeDpaTransactionAsync( const DpaMessage& request, int32_t timeout,
+    IDpaHandler2::CompletionFunc onCompletion, IDpaTransactionResult2::ErrorCode defaultError )
+  {
+    IDpaHandler2::TransactionOptions options;
+    options.timeout = timeout;
+    options.defaultError = defaultError;
+    return executeDpaTransactionAsync( request, options, onCompletion );
+  }
+
+  std::shared_ptr<IDpaTransaction2> executeDpaTransactionAsync( const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+    IDpaHandler2::CompletionFunc onCompletion )
+  {
+    if ( options.retry.maxAttempts > 1 ) {
+      return startRetry( request, options, onCompletion );
+    }
+    std::shared_ptr<DpaTransaction2> ptr = createTransaction( request, options );
+    setCompletion( ptr, onCompletion );
+    queueTransaction( ptr, request, options.deadline );
+    return ptr;
+  }
+
+  void setCompletion( const std::shared_ptr<DpaTransaction2>& ptr, IDpaHandler2::CompletionFunc onCompletion )
+  {
+    std::lock_guard<std::mutex> lck( m_completionExecutorMutex );
+    ptr->setCompletion( onCompletion, m_completionExecutor );
+  }
+
+  std::shared_ptr<IDpaTransaction2> startRetry( const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+    IDpaHandler2::CompletionFunc onCompletion )
+  {
+    IDpaHandler2::CompletionExecutorFunc executor;
+    if ( onCompletion ) {
+      std::lock_guard<std::mutex> lck( m_completionExecutorMutex );
+      executor = m_completionExecutor;
+    }
+    return startRetry( request, options, onCompletion, executor );
+  }
+
+  std::shared_ptr<IDpaTransaction2> startRetry( const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+    IDpaHandler2::CompletionFunc onCompletion, IDpaHandler2::CompletionExecutorFunc executor )
+  {
+    // transaction and its shared_ptr control block are a single pool block
+    std::shared_ptr<RetryTransaction> ptr = std::allocate_shared<RetryTransaction>( DpaPoolAllocator<RetryTransaction>(), *this, request,
+      options, onCompletion, executor );
+    ptr->attempt();
+    return ptr;
+  }
+
+  std::shared_ptr<IDpaTransaction2> executeDpaChain( const DpaMessage& first, IDpaHandler2::ContinuationFunc continuation,
+    const IDpaHandler2::TransactionOptions& options, bool keepInterface )
+  {
+    std::shared_ptr<ChainTransaction> ptr = std::make_shared<ChainTransaction>( *this, continuation, options, keepInterface );
+    ptr->step( first );
+    return ptr;
+  }
+
+  std::shared_ptr<IDpaTransactionGroup> executeDpaTransactions( const std::vector<DpaMessage>& requests,
+    const IDpaHandler2::TransactionOptions& options )
+  {
+    std::shared_ptr<TransactionGroup> group = std::make_shared<TransactionGroup>( requests.size() );
+
+    if ( options.retry.maxAttempts > 1 ) {
+      // attempts of each request are queued independently
+      for ( size_t i = 0; i < requests.size(); i++ ) {
+        group->add( startRetry( requests[i], options, group->completion( i ), nullptr ) );
+      }
+      return group;
+    }
+
+    std::vector<std::shared_ptr<DpaTransaction2>> batch;
+    batch.reserve( requests.size() );
+    for ( size_t i = 0; i < requests.size(); i++ ) {
+      std::shared_ptr<DpaTransaction2> ptr = createTransaction( requests[i], options );
+      // results are just stored to the group, no need of executor
+      ptr->setCompletion( group->completion( i ), nullptr );
+      group->add( ptr );
+      batch.push_back( ptr );
+    }
+    queueTransactions( batch, requests, options.deadline );
+    return group;
+  }
+
+  bool isNodeReachable( uint16_t nadr ) const
+  {
+    std::lock_guard<std::mutex> lck( m_livenessMutex );
+    auto found = m_nodeTimeouts.find( nadr );
+    return found == m_nodeTimeouts.end() || found->second < IDpaHandler2::UNREACHABLE_TIMEOUTS;
+  }
+
+  // reachability including the outcome of a transaction finishing now, updateLiveness() records it after its completion
+  bool isNodeReachable( uint16_t nadr, int errorCode ) const
+  {
+    if ( ( nadr & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS || nadr == BROADCAST_ADDRESS || errorCode >= IDpaTransactionResult2::TRN_OK ) {
+      return true;
+    }
+    std::lock_guard<std::mutex> lck( m_livenessMutex );
+    auto found = m_nodeTimeouts.find( nadr );
+    int timeouts = found != m_nodeTimeouts.end() ? found->second : 0;
+    if ( errorCode == IDpaTransactionResult2::TRN_ERROR_TIMEOUT ) {
+      timeouts++;
+    }
+    return timeouts < IDpaHandler2::UNREACHABLE_TIMEOUTS;
+  }
+
+  std::shared_ptr<IDpaPreparedTransaction> prepareDpaTransaction( const DpaMessage& request, const IDpaHandler2::TransactionOptions& options )
+  {
+    if ( request.GetLength() < static_cast<int>( sizeof( TDpaIFaceHeader ) ) ) {
+      throw std::invalid_argument( "Prepared DPA request is too short." );
+    }
+    return std::make_shared<PreparedTransaction>( *this, request, options );
+  }
+
+  int cancelDpaTransactions( std::function<bool( const std::string& serviceId, uint16_t nadr )> select )
+  {
+    std::vector<std::shared_ptr<DpaTransaction2>> removed = m_dpaTransactionQueue->removeFromQueue(
+      [&]( const std::shared_ptr<DpaTransaction2>& ptr ) {
+        return select( ptr->getServiceId(), ptr->getNodeAddress() );
+      } );
+    std::vector<std::shared_ptr<RetryTransaction>> retries = takeBackoffRetries( select );
+    if ( removed.empty() && retries.empty() ) {
+      return 0;
+    }
+    if ( !removed.empty() ) {
+      std::lock_guard<std::mutex> lck( m_admissionMutex );
+      for ( const auto& ptr : removed ) {
+        m_queuedPredictionMs -= ptr->getPredictedDurationMs();
+        if ( ptr->isBatched() ) {
+          m_batchedQueued--;
+        }
+      }
+      m_inFlight -= removed.size();
+    }
+    TRC_INFORMATION( "Cancelled queued transactions: " << PAR( removed.size() ) << PAR( retries.size() ) );
+    // removed transactions are never dispatched, they are finished here without sending, the result of a transaction
+    // expired meanwhile is delivered as well
+    for ( const auto& ptr : removed ) {
+      ptr->execute( IDpaTransactionResult2::TRN_ERROR_ABORTED );
+    }
+    // retries waiting for backoff finish with their last attempt
+    for ( const auto& ptr : retries ) {
+      ptr->abort();
+    }
+    return static_cast<int>( removed.size() + retries.size() );
+  }
+
+  bool isQueueThread() const
+  {
+    return m_dpaTransactionQueue->isWorkerThread();
+  }
+
+  // chains with keepInterface running their steps, retries aren't queued in front of their next step then
+  void reserveInterface()
+  {
+    m_interfaceReservations++;
+  }
+
+  void releaseInterface()
+  {
+    m_interfaceReservations--;
+  }
+
+  bool isInterfaceReserved() const
+  {
+    return m_interfaceReservations > 0;
+  }
+
+  // run the function by the queue thread before the next queued transaction, it must not throw
+  void post( std::function<void()> func )
+  {
+    m_dpaTransactionQueue->post( std::move( func ) );
+  }
+
+  void setCompletionExecutor( IDpaHandler2::CompletionExecutorFunc executor )
+  {
+    std::lock_guard<std::mutex> lck( m_completionExecutorMutex );
+    m_completionExecutor = executor;
+  }
+
   int getTimeout() const
   {
     return m_defaultTimeout;
@@ -166,27 +455,33 @@ public:
   void setRfCommunicationMode( IDpaTransaction2::RfMode rfMode )
   {
     //TODO set rfMode on iqrf interface
+    if ( rfMode != m_rfMode ) {
+      // times learned in the other mode don't apply
+      m_timeoutEstimator->reset();
+    }
     m_rfMode = rfMode;
   }
 
   IDpaTransaction2::TimingParams getTimingParams() const
   {
-    return m_timingParams;
+    return *m_timingParams;
   }
 
   void setTimingParams( IDpaTransaction2::TimingParams params )
   {
-    m_timingParams = params;
+    m_timingParams = std::make_shared<const IDpaTransaction2::TimingParams>( params );
   }
 
   IDpaTransaction2::FrcResponseTime getFrcResponseTime() const
   {
-    return m_timingParams.frcResponseTime;
+    return m_timingParams->frcResponseTime;
   }
 
   void setFrcResponseTime( IDpaTransaction2::FrcResponseTime frcResponseTime )
   {
-    m_timingParams.frcResponseTime = frcResponseTime;
+    IDpaTransaction2::TimingParams params = *m_timingParams;
+    params.frcResponseTime = frcResponseTime;
+    setTimingParams( params );
   }
 
   ////////////////////
@@ -198,11 +493,11 @@ public:
     m_asyncMessageHandler = fun;
   }
 
-  void processAsynchronousMessage( const DpaMessage& message ) {
+  void processAsynchronousMessage( const DpaMessageView& message ) {
     m_asyncMessageMutex.lock();
 
     if ( m_asyncMessageHandler ) {
-      m_asyncMessageHandler( message );
+      m_asyncMessageHandler( message.ToMessage() );
     }
 
     m_asyncMessageMutex.unlock();
@@ -226,10 +521,15 @@ public:
     }
   }
 
-  void processAnyMessage(const DpaMessage& message) {
+  void processAnyMessage(const DpaMessageView& message) {
     std::lock_guard<std::mutex> lck(m_anyMessageMutex);
+    if (m_anyMessageHandlerMap.empty()) {
+      return;
+    }
+    // handlers get the message once copied to the stack, no heap allocation
+    DpaMessage dpaMessage = message.ToMessage();
     for (auto & it : m_anyMessageHandlerMap) {
-      it.second(message);
+      it.second(dpaMessage);
     }
   }
 
@@ -248,12 +548,855 @@ public:
   }
   
 private:
+  // counters of received messages, see IDpaHandler2::ReceiveStats
+  enum ReceiveCounter {
+    kReceived,
+    kTooLong,
+    kAsynchronous,
+    kMatched,
+    kNoPendingTransaction,
+    kAfterFinish,
+    kNotResponse,
+    kNodeAddressMismatch,
+    kPeripheralTypeMismatch,
+    kPeripheralCommandMismatch,
+    kReceiveCounterCount
+  };
+
+  void count( ReceiveCounter counter )
+  {
+    m_receiveCounters[counter].fetch_add( 1, std::memory_order_relaxed );
+  }
+
+  /// transaction retried by its RetryPolicy, each attempt is a DpaTransaction2 queued again after backoff
+  class RetryTransaction : public IDpaTransaction2, public std::enable_shared_from_this<RetryTransaction>
+  {
+  public:
+    RetryTransaction( Imp& imp, const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+      IDpaHandler2::CompletionFunc onCompletion, IDpaHandler2::CompletionExecutorFunc executor )
+      : m_imp( imp )
+      , m_request( request )
+      , m_options( options )
+      , m_policy( std::move( m_options.retry ) )
+      , m_completion( onCompletion )
+      , m_executor( executor )
+    {
+      // attempts are plain transactions
+      m_options.retry = IDpaHandler2::RetryPolicy();
+    }
+
+    std::unique_ptr<IDpaTransactionResult2> get() override
+    {
+      std::unique_lock<std::mutex> lck( m_mutex );
+      m_condition.wait( lck, [&] { return m_finish; } );
+      return std::move( m_result );
+    }
+
+    void abort() override
+    {
+      std::shared_ptr<DpaTransaction2> current;
+      std::unique_ptr<IDpaTransactionResult2> result;
+      std::shared_ptr<RetryTransaction> owner;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        m_aborted = true;
+        current = m_current;
+        if ( m_timerId != 0 && m_imp.m_timerWheel->cancel( m_timerId ) ) {
+          // waiting for backoff, the last attempt is the result
+          result = std::move( m_lastResult );
+          owner = std::move( m_backoffOwner );
+        }
+        m_timerId = 0;
+      }
+      if ( result ) {
+        m_imp.removeBackoffRetry( this );
+      }
+      if ( current ) {
+        // attemptFinished() gets the aborted result
+        current->abort();
+      }
+      else if ( result ) {
+        result->overrideErrorCode( IDpaTransactionResult2::TRN_ERROR_ABORTED );
+        finish( std::move( result ) );
+      }
+    }
+
+    const std::string& getServiceId() const { return m_options.serviceId; }
+    uint16_t getNodeAddress() const { return m_request.NodeAddress(); }
+
+    // called by handler destructor, the stopped timer and queue never run the backoff
+    void dropBackoff()
+    {
+      std::lock_guard<std::mutex> lck( m_mutex );
+      m_backoffOwner.reset();
+    }
+
+    // queue next attempt
+    void attempt()
+    {
+      std::shared_ptr<DpaTransaction2> ptr = m_imp.createTransaction( m_request, m_options );
+      // the completion captures just a pointer, so std::function doesn't allocate, m_attemptOwner keeps the retry alive
+      ptr->setCompletion( [this]( std::unique_ptr<IDpaTransactionResult2> result ) {
+        attemptFinished( std::move( result ) );
+      }, nullptr );
+
+      bool front = false;
+      bool aborted = false;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        m_attemptOwner = shared_from_this();
+        aborted = m_aborted;
+        if ( !aborted ) {
+          m_current = ptr;
+          // a chain keeping the interface isn't overtaken, its next step may be queued after posted backoffExpired()
+          front = m_attempts > 0 && m_policy.requeueAtHead && !m_imp.isInterfaceReserved();
+          m_attempts++;
+        }
+      }
+      if ( aborted ) {
+        // aborted meanwhile, the attempt is finished at once
+        ptr->execute( IDpaTransactionResult2::TRN_ERROR_ABORTED );
+        return;
+      }
+      m_imp.queueTransaction( ptr, m_request, m_options.deadline, front );
+    }
+
+  private:
+    void attemptFinished( std::unique_ptr<IDpaTransactionResult2> result )
+    {
+      int errorCode = result->getErrorCode();
+      // the queue thread records the attempt to liveness after this completion, so its outcome is counted here
+      bool retry = isRetried( errorCode ) && m_imp.isNodeReachable( m_request.NodeAddress(), errorCode );
+
+      std::unique_lock<std::mutex> lck( m_mutex );
+      m_current.reset();
+      std::shared_ptr<RetryTransaction> owner = std::move( m_attemptOwner );
+      if ( retry && !m_aborted && m_attempts < m_policy.maxAttempts ) {
+        int32_t backoffMs = m_policy.backoffMs;
+        for ( int i = 1; i < m_attempts && backoffMs < m_policy.maxBackoffMs; i++ ) {
+          backoffMs *= 2;
+        }
+        backoffMs = std::min( backoffMs, m_policy.maxBackoffMs );
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() + std::chrono::milliseconds( backoffMs );
+        if ( start < m_options.deadline ) {
+          TRC_INFORMATION( "Transaction retry: " << PAR( errorCode ) << PAR( m_attempts ) << PAR( backoffMs ) );
+          m_lastResult = std::move( result );
+          // m_backoffOwner keeps the transaction alive, asynchronous caller may not hold it. The next attempt is queued
+          // by the queue thread, the timer thread doesn't run completions of rejected attempts.
+          m_backoffOwner = std::move( owner );
+          m_imp.addBackoffRetry( m_backoffOwner );
+          m_timerId = m_imp.m_timerWheel->schedule( start, [this]() {
+            m_imp.post( [this]() {
+              backoffExpired();
+            } );
+          } );
+          return;
+        }
+      }
+      lck.unlock();
+      finish( std::move( result ) );
+    }
+
+    void backoffExpired()
+    {
+      std::unique_ptr<IDpaTransactionResult2> result;
+      std::shared_ptr<RetryTransaction> owner;
+      m_imp.removeBackoffRetry( this );
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        m_timerId = 0;
+        result = std::move( m_lastResult );
+        owner = std::move( m_backoffOwner );
+      }
+      try {
+        if ( m_aborted ) {
+          // aborted while the timer was expiring
+          result->overrideErrorCode( IDpaTransactionResult2::TRN_ERROR_ABORTED );
+          finish( std::move( result ) );
+          return;
+        }
+        attempt();
+      }
+      catch ( std::exception& e ) {
+        CATCH_EXC_TRC_WAR( std::exception, e, "Transaction retry error: " );
+      }
+    }
+
+    bool isRetried( int errorCode ) const
+    {
+      if ( errorCode == IDpaTransactionResult2::TRN_ERROR_ABORTED ) {
+        // attempt cancelled by cancelDpaTransactions()
+        return false;
+      }
+      if ( m_policy.retryOn.empty() ) {
+        return errorCode == IDpaTransactionResult2::TRN_ERROR_TIMEOUT || errorCode == IDpaTransactionResult2::TRN_ERROR_IFACE_BUSY;
+      }
+      return std::find( m_policy.retryOn.begin(), m_policy.retryOn.end(), errorCode ) != m_policy.retryOn.end();
+    }
+
+    void finish( std::unique_ptr<IDpaTransactionResult2> result )
+    {
+      if ( m_completion ) {
+        // the result waits in the transaction, the task captures just a pointer, see DpaTransaction2::complete()
+        m_completionResult = std::move( result );
+        if ( m_executor ) {
+          m_completionOwner = shared_from_this();
+          std::function<void()> task = [this]() {
+            std::shared_ptr<RetryTransaction> owner = std::move( m_completionOwner );
+            runCompletion();
+          };
+          try {
+            m_executor( task );
+          }
+          catch ( std::exception& e ) {
+            CATCH_EXC_TRC_WAR( std::exception, e, "Completion executor error: " );
+          }
+        }
+        else {
+          runCompletion();
+        }
+      }
+      std::lock_guard<std::mutex> lck( m_mutex );
+      m_result = std::move( result );
+      m_finish = true;
+      m_condition.notify_all();
+    }
+
+    void runCompletion()
+    {
+      try {
+        m_completion( std::move( m_completionResult ) );
+      }
+      catch ( std::exception& e ) {
+        CATCH_EXC_TRC_WAR( std::exception, e, "Completion handler error: " );
+      }
+    }
+
+    Imp& m_imp;
+    const DpaMessage m_request;
+    IDpaHandler2::TransactionOptions m_options;
+    const IDpaHandler2::RetryPolicy m_policy;
+    IDpaHandler2::CompletionFunc m_completion;
+    IDpaHandler2::CompletionExecutorFunc m_executor;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::shared_ptr<DpaTransaction2> m_current;
+    std::unique_ptr<IDpaTransactionResult2> m_lastResult;
+    std::unique_ptr<IDpaTransactionResult2> m_result;
+    std::unique_ptr<IDpaTransactionResult2> m_completionResult;
+    std::shared_ptr<RetryTransaction> m_completionOwner;
+    // keep the transaction alive while its attempt is queued and while it waits for backoff
+    std::shared_ptr<RetryTransaction> m_attemptOwner;
+    std::shared_ptr<RetryTransaction> m_backoffOwner;
+    DpaTimerWheel::TimerId m_timerId = 0;
+    int m_attempts = 0;
+    std::atomic<bool> m_aborted { false };
+    bool m_finish = false;
+  };
+
+  // retry waits for backoff, it is visible to cancelDpaTransactions() until removeBackoffRetry()
+  void addBackoffRetry( const std::shared_ptr<RetryTransaction>& ptr )
+  {
+    std::lock_guard<std::mutex> lck( m_backoffRetriesMutex );
+    m_backoffRetries.push_back( ptr );
+  }
+
+  void removeBackoffRetry( const RetryTransaction* ptr )
+  {
+    std::lock_guard<std::mutex> lck( m_backoffRetriesMutex );
+    auto found = std::find_if( m_backoffRetries.begin(), m_backoffRetries.end(), [&]( const std::shared_ptr<RetryTransaction>& retry ) {
+      return retry.get() == ptr;
+    } );
+    if ( found != m_backoffRetries.end() ) {
+      m_backoffRetries.erase( found );
+    }
+  }
+
+  std::vector<std::shared_ptr<RetryTransaction>> takeBackoffRetries( std::function<bool( const std::string& serviceId, uint16_t nadr )> select )
+  {
+    std::vector<std::shared_ptr<RetryTransaction>> taken;
+    std::lock_guard<std::mutex> lck( m_backoffRetriesMutex );
+    for ( auto it = m_backoffRetries.begin(); it != m_backoffRetries.end(); ) {
+      if ( select( ( *it )->getServiceId(), ( *it )->getNodeAddress() ) ) {
+        taken.push_back( std::move( *it ) );
+        it = m_backoffRetries.erase( it );
+      }
+      else {
+        ++it;
+      }
+    }
+    return taken;
+  }
+
+  /// chain of dependent transactions, the next request is built by continuation from the result of the previous step
+  class ChainTransaction : public IDpaTransaction2, public std::enable_shared_from_this<ChainTransaction>
+  {
+  public:
+    ChainTransaction( Imp& imp, IDpaHandler2::ContinuationFunc continuation, const IDpaHandler2::TransactionOptions& options,
+      bool keepInterface )
+      : m_imp( imp )
+      , m_continuation( continuation )
+      , m_options( options )
+      , m_keepInterface( keepInterface )
+    {
+      m_options.retry = IDpaHandler2::RetryPolicy();
+    }
+
+    std::unique_ptr<IDpaTransactionResult2> get() override
+    {
+      std::unique_lock<std::mutex> lck( m_mutex );
+      m_condition.wait( lck, [&] { return m_finish; } );
+      return std::move( m_result );
+    }
+
+    void abort() override
+    {
+      std::shared_ptr<DpaTransaction2> current;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        m_aborted = true;
+        current = m_current;
+      }
+      if ( current ) {
+        current->abort();
+      }
+    }
+
+    // queue step of the chain
+    void step( const DpaMessage& request )
+    {
+      std::shared_ptr<DpaTransaction2> ptr = m_imp.createTransaction( request, m_options );
+      std::shared_ptr<ChainTransaction> self = shared_from_this();
+      ptr->setCompletion( [self]( std::unique_ptr<IDpaTransactionResult2> result ) {
+        self->stepFinished( std::move( result ) );
+      }, nullptr );
+
+      bool front = false;
+      bool aborted = false;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        aborted = m_aborted;
+        if ( !aborted ) {
+          m_current = ptr;
+          // the first step waits in queue as other transactions
+          front = m_keepInterface && m_steps > 0;
+          m_steps++;
+        }
+      }
+      if ( aborted ) {
+        ptr->execute( IDpaTransactionResult2::TRN_ERROR_ABORTED );
+        return;
+      }
+      m_imp.queueTransaction( ptr, request, m_options.deadline, front );
+    }
+
+  private:
+    void stepFinished( std::unique_ptr<IDpaTransactionResult2> result )
+    {
+      bool post = false;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        m_current.reset();
+        if ( result->getErrorCode() == IDpaTransactionResult2::TRN_ERROR_ABORTED ) {
+          // step aborted by abort() or cancelDpaTransactions() ends the chain
+          m_aborted = true;
+        }
+        if ( m_aborted ) {
+          finish( std::move( result ) );
+          return;
+        }
+        if ( m_keepInterface && !m_reserved ) {
+          // from the first step to the end of chain, released by finish()
+          m_reserved = true;
+          m_imp.reserveInterface();
+        }
+        if ( !m_imp.isQueueThread() ) {
+          // e.g. the step rejected by admission control, the continuation is run by the queue thread anyway
+          m_stepResult = std::move( result );
+          post = true;
+        }
+      }
+      if ( post ) {
+        std::shared_ptr<ChainTransaction> self = shared_from_this();
+        m_imp.post( [self]() {
+          self->continueChain();
+        } );
+        return;
+      }
+      runContinuation( std::move( result ) );
+    }
+
+    // continuation posted to the queue thread
+    void continueChain()
+    {
+      std::unique_ptr<IDpaTransactionResult2> result;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        result = std::move( m_stepResult );
+        if ( m_aborted ) {
+          finish( std::move( result ) );
+          return;
+        }
+      }
+      try {
+        runContinuation( std::move( result ) );
+      }
+      catch ( std::exception& e ) {
+        CATCH_EXC_TRC_WAR( std::exception, e, "Chain step error: " );
+      }
+    }
+
+    void runContinuation( std::unique_ptr<IDpaTransactionResult2> result )
+    {
+      DpaMessage next;
+      bool proceed = false;
+      try {
+        proceed = m_continuation( *result, next );
+      }
+      catch ( std::exception& e ) {
+        CATCH_EXC_TRC_WAR( std::exception, e, "Chain continuation error: " );
+        proceed = false;
+      }
+
+      std::unique_lock<std::mutex> lck( m_mutex );
+      if ( proceed ) {
+        TRC_DEBUG( "Chain step: " << PAR( m_steps ) );
+        lck.unlock();
+        step( next );
+      }
+      else {
+        finish( std::move( result ) );
+      }
+    }
+
+    // called with m_mutex locked
+    void finish( std::unique_ptr<IDpaTransactionResult2> result )
+    {
+      if ( m_reserved ) {
+        m_reserved = false;
+        m_imp.releaseInterface();
+      }
+      m_result = std::move( result );
+      m_finish = true;
+      m_condition.notify_all();
+    }
+
+    Imp& m_imp;
+    IDpaHandler2::ContinuationFunc m_continuation;
+    IDpaHandler2::TransactionOptions m_options;
+    const bool m_keepInterface;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::shared_ptr<DpaTransaction2> m_current;
+    std::unique_ptr<IDpaTransactionResult2> m_result;
+    // result of the step waiting for continueChain()
+    std::unique_ptr<IDpaTransactionResult2> m_stepResult;
+    int m_steps = 0;
+    bool m_reserved = false;
+    bool m_aborted = false;
+    bool m_finish = false;
+  };
+
+  /// results of transactions submitted together
+  class TransactionGroup : public IDpaTransactionGroup, public std::enable_shared_from_this<TransactionGroup>
+  {
+  public:
+    explicit TransactionGroup( size_t size )
+      : m_size( size )
+      , m_results( size )
+    {
+      m_transactions.reserve( size );
+      m_completed.reserve( size );
+    }
+
+    void add( std::shared_ptr<IDpaTransaction2> transaction )
+    {
+      std::lock_guard<std::mutex> lck( m_mutex );
+      m_transactions.push_back( transaction );
+    }
+
+    // completion of transaction of the request with index
+    IDpaHandler2::CompletionFunc completion( size_t index )
+    {
+      // transactions keep their completion, so the group is not owned by them
+      std::weak_ptr<TransactionGroup> group( shared_from_this() );
+      return [group, index]( std::unique_ptr<IDpaTransactionResult2> result ) {
+        if ( std::shared_ptr<TransactionGroup> ptr = group.lock() ) {
+          ptr->completed( index, std::move( result ) );
+        }
+      };
+    }
+
+    size_t size() const override
+    {
+      return m_size;
+    }
+
+    std::vector<std::unique_ptr<IDpaTransactionResult2>> waitAll() override
+    {
+      std::unique_lock<std::mutex> lck( m_mutex );
+      m_condition.wait( lck, [&] { return m_completed.size() == m_size; } );
+      // all results are taken
+      m_taken = m_size;
+      std::vector<std::unique_ptr<IDpaTransactionResult2>> results;
+      results.reserve( m_size );
+      for ( auto& result : m_results ) {
+        results.push_back( std::move( result ) );
+      }
+      return results;
+    }
+
+    std::unique_ptr<IDpaTransactionResult2> waitAny( int& index ) override
+    {
+      std::unique_lock<std::mutex> lck( m_mutex );
+      m_condition.wait( lck, [&] { return m_taken < m_completed.size() || m_taken >= m_size; } );
+      if ( m_taken >= m_size ) {
+        index = -1;
+        return nullptr;
+      }
+      size_t completed = m_completed[m_taken++];
+      index = static_cast<int>( completed );
+      return std::move( m_results[completed] );
+    }
+
+    void abort() override
+    {
+      std::vector<std::shared_ptr<IDpaTransaction2>> transactions;
+      {
+        std::lock_guard<std::mutex> lck( m_mutex );
+        transactions = m_transactions;
+      }
+      for ( const auto& transaction : transactions ) {
+        transaction->abort();
+      }
+    }
+
+  private:
+    void completed( size_t index, std::unique_ptr<IDpaTransactionResult2> result )
+    {
+      std::lock_guard<std::mutex> lck( m_mutex );
+      m_results[index] = std::move( result );
+      m_completed.push_back( index );
+      m_condition.notify_all();
+    }
+
+    const size_t m_size;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<std::shared_ptr<IDpaTransaction2>> m_transactions;
+    std::vector<std::unique_ptr<IDpaTransactionResult2>> m_results;
+    // indexes of results in order of completion, the first m_taken of them are taken by waitAny()
+    std::vector<size_t> m_completed;
+    size_t m_taken = 0;
+  };
+
+  /// request checked and classified once, executed with patched address and PData
+  class PreparedTransaction : public IDpaPreparedTransaction
+  {
+  public:
+    PreparedTransaction( Imp& imp, const DpaMessage& request, const IDpaHandler2::TransactionOptions& options )
+      : m_imp( imp )
+      , m_request( request )
+      , m_options( options )
+      , m_profile( DpaTransaction2::makeProfile( request, imp.m_defaultTimeout, options.timeout ) )
+    {
+    }
+
+    std::shared_ptr<IDpaTransaction2> execute( uint16_t nadr, const uint8_t* pdata, int length ) override
+    {
+      DpaMessage request = makeRequest( nadr, pdata, length );
+      if ( m_options.retry.maxAttempts > 1 ) {
+        return m_imp.startRetry( request, m_options, nullptr );
+      }
+      std::shared_ptr<DpaTransaction2> ptr = m_imp.createTransaction( request, profile( request ), m_options );
+      m_imp.queueTransaction( ptr, request, m_options.deadline );
+      return ptr;
+    }
+
+    std::shared_ptr<IDpaTransaction2> executeAsync( uint16_t nadr, CompletionFunc onCompletion, const uint8_t* pdata, int length ) override
+    {
+      DpaMessage request = makeRequest( nadr, pdata, length );
+      if ( m_options.retry.maxAttempts > 1 ) {
+        return m_imp.startRetry( request, m_options, onCompletion );
+      }
+      std::shared_ptr<DpaTransaction2> ptr = m_imp.createTransaction( request, profile( request ), m_options );
+      m_imp.setCompletion( ptr, onCompletion );
+      m_imp.queueTransaction( ptr, request, m_options.deadline );
+      return ptr;
+    }
+
+    const DpaMessage& getRequest() const override
+    {
+      return m_request;
+    }
+
+  private:
+    DpaMessage makeRequest( uint16_t nadr, const uint8_t* pdata, int length ) const
+    {
+      DpaMessage request( m_request );
+      request.SetNodeAddress( nadr );
+      if ( pdata != nullptr ) {
+        if ( length != m_request.GetLength() - static_cast<int>( sizeof( TDpaIFaceHeader ) ) ) {
+          throw std::length_error( "PData length differs from the prepared request." );
+        }
+        std::memcpy( request.DpaPacketData() + sizeof( TDpaIFaceHeader ), pdata, length );
+      }
+      return request;
+    }
+
+    DpaTransaction2::Profile profile( const DpaMessage& request ) const
+    {
+      bool toCoordinator = ( request.NodeAddress() & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS;
+      if ( toCoordinator != m_profile.toCoordinator || m_profile.defaultTimeout != m_imp.m_defaultTimeout ) {
+        // prepared for other addressing or default timeout changed meanwhile
+        return DpaTransaction2::makeProfile( request, m_imp.m_defaultTimeout, m_options.timeout );
+      }
+      return m_profile;
+    }
+
+    Imp& m_imp;
+    const DpaMessage m_request;
+    const IDpaHandler2::TransactionOptions m_options;
+    const DpaTransaction2::Profile m_profile;
+  };
+
+  std::shared_ptr<DpaTransaction2> createTransaction( const DpaMessage& request, const IDpaHandler2::TransactionOptions& options )
+  {
+    return createTransaction( request, DpaTransaction2::makeProfile( request, m_defaultTimeout, options.timeout ), options );
+  }
+
+  std::shared_ptr<DpaTransaction2> createTransaction( const DpaMessage& request, const DpaTransaction2::Profile& profile,
+    const IDpaHandler2::TransactionOptions& options )
+  {
+    // transaction and its shared_ptr control block are a single pool block
+    std::shared_ptr<DpaTransaction2> ptr = std::allocate_shared<DpaTransaction2>( DpaPoolAllocator<DpaTransaction2>(), request,
+      profile, m_rfMode, m_timingParams,
+      [&]( const DpaMessage& r ) {
+        sendRequest( r );
+      },
+      options.defaultError
+    );
+    if ( options.onProgress ) {
+      ptr->setProgress( options.onProgress );
+    }
+    ptr->setTimeoutEstimator( m_timeoutEstimator, m_adaptiveTimeout );
+    ptr->setTimerWheel( m_timerWheel );
+    if ( m_releaseResultOnResponse ) {
+      ptr->setReleaseResultOnResponse( true );
+    }
+    if ( !options.serviceId.empty() ) {
+      ptr->setServiceId( internServiceId( options.serviceId ) );
+    }
+    if ( options.deadline != std::chrono::steady_clock::time_point::max() ) {
+      ptr->setStartDeadline( options.deadline );
+    }
+    ptr->setPredictedDurationMs( predictDurationMs( request, profile ) );
+    return ptr;
+  }
+
+  // shared copy of service id, services are few so the ids are kept for the handler lifetime
+  std::shared_ptr<const std::string> internServiceId( const std::string& serviceId )
+  {
+    std::lock_guard<std::mutex> lck( m_serviceIdsMutex );
+    auto found = m_serviceIds.find( serviceId );
+    if ( found != m_serviceIds.end() ) {
+      return found->second;
+    }
+    std::shared_ptr<const std::string> id = std::make_shared<const std::string>( serviceId );
+    m_serviceIds.insert( std::make_pair( serviceId, id ) );
+    return id;
+  }
+
+  // predicted time the transaction occupies the interface
+  int32_t predictDurationMs( const DpaMessage& request, const DpaTransaction2::Profile& profile ) const
+  {
+    if ( m_adaptiveTimeout && !profile.toCoordinator && request.NodeAddress() != BROADCAST_ADDRESS ) {
+      // learned confirmation to response time of the node if any, only if the transaction waits for it
+      int32_t estimateMs = m_timeoutEstimator->estimate( request.NodeAddress(), 0 );
+      if ( estimateMs > 0 ) {
+        return estimateMs;
+      }
+    }
+    // the time the transaction waits if nothing is received
+    return static_cast<int32_t>( profile.expectedDurationMs );
+  }
+
+  // admission control, called with m_admissionMutex locked
+  bool admit( const std::shared_ptr<DpaTransaction2>& ptr, std::chrono::steady_clock::time_point deadline )
+  {
+    if ( deadline == std::chrono::steady_clock::time_point::max() ) {
+      return true;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point start = std::max( now, m_pendingPredictedEnd ) + std::chrono::milliseconds( m_queuedPredictionMs );
+    if ( start > deadline ) {
+      TRC_WARNING( "Transaction can't start until its deadline: " << PAR( m_queuedPredictionMs ) << PAR( ptr->getPredictedDurationMs() ) );
+      return false;
+    }
+    return true;
+  }
+
+  // called by queue worker when the transaction is taken from queue, returns queue length without batched transactions
+  size_t dequeued( const std::shared_ptr<DpaTransaction2>& ptr )
+  {
+    std::lock_guard<std::mutex> lck( m_admissionMutex );
+    m_queuedPredictionMs -= ptr->getPredictedDurationMs();
+    m_pendingPredictedEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds( ptr->getPredictedDurationMs() );
+    if ( ptr->isBatched() ) {
+      m_batchedQueued--;
+    }
+    size_t size = m_dpaTransactionQueue->size();
+    return size > m_batchedQueued ? size - m_batchedQueued : 0;
+  }
+
+  // called by queue worker when the transaction finished, the interface is free regardless of the prediction
+  void executed()
+  {
+    std::lock_guard<std::mutex> lck( m_admissionMutex );
+    m_pendingPredictedEnd = std::chrono::steady_clock::now();
+    m_inFlight--;
+  }
+
+  // execute the transaction by the calling thread if nothing is queued or pending, returns false if it has to be queued
+  bool executeInline( const std::shared_ptr<DpaTransaction2>& ptr, const DpaMessage& request,
+    std::chrono::steady_clock::time_point deadline )
+  {
+    if ( request.GetLength() <= 0 ) {
+      return false;
+    }
+    if ( m_releaseResultOnResponse && ( request.NodeAddress() & BROADCAST_ADDRESS ) != COORDINATOR_ADDRESS ) {
+      // the caller would wait for the rest of expected duration after the response released the result
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lck( m_admissionMutex );
+      // transactions submitted meanwhile see it in flight and are queued after it
+      if ( m_inFlight > 0 || !admit( ptr, deadline ) ) {
+        return false;
+      }
+      m_inFlight++;
+      m_pendingPredictedEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds( ptr->getPredictedDurationMs() );
+    }
+    ptr->queued();
+    {
+      // the worker may still be leaving the previous transaction
+      std::lock_guard<std::mutex> lck( m_executeMutex );
+      m_pendingTransaction = ptr;
+      m_pendingTransaction->execute();
+    }
+    executed();
+    updateLiveness( ptr->getNodeAddress(), ptr->getErrorCode() );
+    return true;
+  }
+
+  void queueTransaction( const std::shared_ptr<DpaTransaction2>& ptr, const DpaMessage& request,
+    std::chrono::steady_clock::time_point deadline, bool front = false )
+  {
+    if ( request.GetLength() <= 0 ) {
+      // nothing to send, the transaction is finished immediately
+      TRC_WARNING( "Empty request => nothing to sent and transaction aborted" );
+      ptr->execute( IDpaTransactionResult2::TRN_ERROR_BAD_REQUEST );
+      return;
+    }
+    bool admitted = false;
+    {
+      // the queue time is reserved here, observers and completions are called out of the lock
+      std::lock_guard<std::mutex> lck( m_admissionMutex );
+      admitted = admit( ptr, deadline );
+      if ( admitted ) {
+        m_queuedPredictionMs += ptr->getPredictedDurationMs();
+        m_inFlight++;
+      }
+    }
+    if ( !admitted ) {
+      ptr->execute( IDpaTransactionResult2::TRN_ERROR_IFACE_BUSY );
+      return;
+    }
+    // reported before pushing so the observer gets the stages in order
+    ptr->queued();
+    if ( front ) {
+      m_dpaTransactionQueue->pushToQueueFront( ptr );
+    }
+    else {
+      m_dpaTransactionQueue->pushToQueue( ptr );
+    }
+  }
+
+  void queueTransactions( const std::vector<std::shared_ptr<DpaTransaction2>>& batch, const std::vector<DpaMessage>& requests,
+    std::chrono::steady_clock::time_point deadline )
+  {
+    // the batch is a single submission for the queue length limit
+    size_t size = m_dpaTransactionQueue->size();
+    if ( size >= QUEUE_MAX_LEN ) {
+      TRC_ERROR( "Transaction queue overload: " << PAR( size ) << PAR( batch.size() ) );
+      for ( const auto& ptr : batch ) {
+        ptr->execute( IDpaTransactionResult2::TRN_ERROR_IFACE_QUEUE_FULL );
+      }
+      return;
+    }
+
+    std::vector<std::shared_ptr<DpaTransaction2>> admitted;
+    std::vector<IDpaTransactionResult2::ErrorCode> errors( batch.size(), IDpaTransactionResult2::TRN_OK );
+    admitted.reserve( batch.size() );
+    {
+      std::lock_guard<std::mutex> lck( m_admissionMutex );
+      for ( size_t i = 0; i < batch.size(); i++ ) {
+        if ( requests[i].GetLength() <= 0 ) {
+          errors[i] = IDpaTransactionResult2::TRN_ERROR_BAD_REQUEST;
+        }
+        else if ( !admit( batch[i], deadline ) ) {
+          errors[i] = IDpaTransactionResult2::TRN_ERROR_IFACE_BUSY;
+        }
+        else {
+          m_queuedPredictionMs += batch[i]->getPredictedDurationMs();
+          m_inFlight++;
+          batch[i]->setBatched( true );
+          admitted.push_back( batch[i] );
+        }
+      }
+      m_batchedQueued += admitted.size();
+    }
+
+    for ( size_t i = 0; i < batch.size(); i++ ) {
+      if ( errors[i] != IDpaTransactionResult2::TRN_OK ) {
+        batch[i]->execute( errors[i] );
+      }
+    }
+    for ( const auto& ptr : admitted ) {
+      ptr->queued();
+    }
+    m_dpaTransactionQueue->pushToQueue( admitted );
+  }
+
+  // called by queue worker when the transaction finished
+  void updateLiveness( uint16_t nadr, int errorCode )
+  {
+    if ( ( nadr & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS || nadr == BROADCAST_ADDRESS ) {
+      return;
+    }
+    std::lock_guard<std::mutex> lck( m_livenessMutex );
+    if ( errorCode == IDpaTransactionResult2::TRN_ERROR_TIMEOUT ) {
+      int& timeouts = m_nodeTimeouts[nadr];
+      if ( ++timeouts == IDpaHandler2::UNREACHABLE_TIMEOUTS ) {
+        TRC_WARNING( "Node unreachable: " << PAR( nadr ) );
+      }
+    }
+    else if ( errorCode >= IDpaTransactionResult2::TRN_OK ) {
+      // the node responded
+      m_nodeTimeouts.erase( nadr );
+    }
+  }
+
   void sendRequest( const DpaMessage& request )
   {
     TRC_INFORMATION( "<<<<<<<<<<<<<<<<<<" << std::endl <<
              "Sent to DPA interface: " << std::endl << MEM_HEX( request.DpaPacketData(), request.GetLength() ) );
     try {
-      m_iqrfInterface->sendTo(std::basic_string<unsigned char>(request.DpaPacketData(), request.GetLength()));
+      // just the pending transaction sends, the buffer keeps its capacity
+      m_sendBuffer.assign( request.DpaPacketData(), request.GetLength() );
+      m_iqrfInterface->sendTo( m_sendBuffer );
     }
     catch (std::exception &e) {
       CATCH_EXC_TRC_WAR(std::exception, e, "Cannot send DPA message to coordinator: ");
@@ -261,7 +1404,8 @@ private:
   }
 
   IDpaTransaction2::RfMode m_rfMode = IDpaTransaction2::RfMode::kStd;
-  IDpaTransaction2::TimingParams m_timingParams;
+  // replaced as a whole when changed, transactions share the snapshot
+  std::shared_ptr<const IDpaTransaction2::TimingParams> m_timingParams;
 
   AsyncMessageHandlerFunc m_asyncMessageHandler;
   std::mutex m_asyncMessageMutex;
@@ -269,10 +1413,48 @@ private:
   std::map<std::string, AnyMessageHandlerFunc> m_anyMessageHandlerMap;
   std::mutex m_anyMessageMutex;
 
+  IDpaHandler2::CompletionExecutorFunc m_completionExecutor;
+  std::mutex m_completionExecutorMutex;
+
+  /// service ids of transactions, see internServiceId()
+  std::map<std::string, std::shared_ptr<const std::string>> m_serviceIds;
+  std::mutex m_serviceIdsMutex;
+
   IChannel* m_iqrfInterface = nullptr;
+  // frame passed to IChannel::sendTo(), reused by sendRequest()
+  std::basic_string<unsigned char> m_sendBuffer;
   int m_defaultTimeout = IDpaTransaction2::DEFAULT_TIMEOUT;
 
+  // drives the deadlines of all transactions
+  std::shared_ptr<DpaTimerWheel> m_timerWheel = std::make_shared<DpaTimerWheel>();
+  std::shared_ptr<DpaTimeoutEstimator> m_timeoutEstimator = std::make_shared<DpaTimeoutEstimator>();
+  std::atomic<bool> m_adaptiveTimeout { false };
+  std::atomic<bool> m_releaseResultOnResponse { false };
+  std::atomic<bool> m_inlineExecution { false };
+  // number of chains keeping the interface, see reserveInterface()
+  std::atomic<int> m_interfaceReservations { 0 };
+
+  // sum of predicted durations of queued transactions and predicted end of the pending one
+  int64_t m_queuedPredictionMs = 0;
+  // number of queued transactions submitted in batches
+  size_t m_batchedQueued = 0;
+  // number of queued and executed transactions, the inline execution is possible just when zero
+  size_t m_inFlight = 0;
+  std::chrono::steady_clock::time_point m_pendingPredictedEnd;
+  std::mutex m_admissionMutex;
+
+  // consecutive timeouts of nodes, nodes responding are not present
+  std::map<uint16_t, int> m_nodeTimeouts;
+  mutable std::mutex m_livenessMutex;
+
+  // retries waiting for backoff, the timers hold them as well
+  std::vector<std::shared_ptr<RetryTransaction>> m_backoffRetries;
+  std::mutex m_backoffRetriesMutex;
+
+  // held by the thread executing m_pendingTransaction, the queue worker or a thread executing inline
+  std::mutex m_executeMutex;
   std::shared_ptr<DpaTransaction2> m_pendingTransaction;
+  std::atomic<uint64_t> m_receiveCounters[kReceiveCounterCount] = {};
   TaskQueue<std::shared_ptr<DpaTransaction2>>* m_dpaTransactionQueue = nullptr;
 };
 
@@ -295,11 +1477,114 @@ std::shared_ptr<IDpaTransaction2> DpaHandler2::executeDpaTransaction( const DpaM
   return m_imp->executeDpaTransaction( request, timeout, defaultError );
 }
 
+std::shared_ptr<IDpaTransaction2> DpaHandler2::executeDpaTransactionAsync( const DpaMessage& request, int32_t timeout,
+  IDpaHandler2::CompletionFunc onCompletion, IDpaTransactionResult2::ErrorCode defaultError )
+{
+  return m_imp->executeDpaTransactionAsync( request, timeout, onCompletion, defaultError );
+}
+
+std::shared_ptr<IDpaTransaction2> DpaHandler2::executeDpaTransaction( const DpaMessage& request, const TransactionOptions& options )
+{
+  return m_imp->executeDpaTransaction( request, options );
+}
+
+std::shared_ptr<IDpaTransaction2> DpaHandler2::executeDpaTransactionAsync( const DpaMessage& request, const TransactionOptions& options,
+  IDpaHandler2::CompletionFunc onCompletion )
+{
+  return m_imp->executeDpaTransactionAsync( request, options, onCompletion );
+}
+
+std::shared_ptr<IDpaTransaction2> DpaHandler2::executeDpaChain( const DpaMessage& first, ContinuationFunc continuation,
+  const TransactionOptions& options, bool keepInterface )
+{
+  return m_imp->executeDpaChain( first, continuation, options, keepInterface );
+}
+
+std::shared_ptr<IDpaTransactionGroup> DpaHandler2::executeDpaTransactions( const std::vector<DpaMessage>& requests,
+  const TransactionOptions& options )
+{
+  return m_imp->executeDpaTransactions( requests, options );
+}
+
+std::shared_ptr<IDpaPreparedTransaction> DpaHandler2::prepareDpaTransaction( const DpaMessage& request, const TransactionOptions& options )
+{
+  return m_imp->prepareDpaTransaction( request, options );
+}
+
+bool DpaHandler2::isNodeReachable( uint16_t nadr ) const
+{
+  return m_imp->isNodeReachable( nadr );
+}
+
+int DpaHandler2::cancelDpaTransactions( const std::string& serviceId )
+{
+  return m_imp->cancelDpaTransactions( [&]( const std::string& id, uint16_t ) {
+    return id == serviceId;
+  } );
+}
+
+int DpaHandler2::cancelDpaTransactions( uint16_t nadr )
+{
+  return m_imp->cancelDpaTransactions( [&]( const std::string&, uint16_t address ) {
+    return address == nadr;
+  } );
+}
+
+void DpaHandler2::setCompletionExecutor( IDpaHandler2::CompletionExecutorFunc executor )
+{
+  m_imp->setCompletionExecutor( executor );
+}
+
 int DpaHandler2::getTimeout() const
 {
   return m_imp->getTimeout();
 }
 
+void DpaHandler2::setAdaptiveTimeout( bool enable )
+{
+  m_imp->setAdaptiveTimeout( enable );
+}
+
+bool DpaHandler2::getAdaptiveTimeout() const
+{
+  return m_imp->getAdaptiveTimeout();
+}
+
+std::map<uint16_t, IDpaHandler2::TimeoutStats> DpaHandler2::getNodeTimeoutStats() const
+{
+  return m_imp->getNodeTimeoutStats();
+}
+
+std::map<uint8_t, IDpaHandler2::TimeoutStats> DpaHandler2::getHopsTimeoutStats() const
+{
+  return m_imp->getHopsTimeoutStats();
+}
+
+void DpaHandler2::resetTimeoutStats()
+{
+  m_imp->resetTimeoutStats();
+}
+
+void DpaHandler2::setReleaseResultOnResponse( bool enable )
+{
+  m_imp->setReleaseResultOnResponse( enable );
+}
+
+bool DpaHandler2::getReleaseResultOnResponse() const
+{
+  return m_imp->getReleaseResultOnResponse();
+}
+
+void DpaHandler2::setInlineExecution( bool enable )
+{
+  m_imp->setInlineExecution( enable );
+}
+
+bool DpaHandler2::getInlineExecution() const
+{
+  return m_imp->getInlineExecution();
+}
+
 void DpaHandler2::setTimeout( int timeout )
 {
   m_imp->setTimeout( timeout );
@@ -359,3 +1644,8 @@ void DpaHandler2::unregisterAnyMessageHandler(const std::string& serviceId)
 {
   m_imp->unregisterAnyMessageHandler(serviceId);
 }
+
+IDpaHandler2::ReceiveStats DpaHandler2::getReceiveStats() const
+{
+  return m_imp->getReceiveStats();
+}
@@ -23,6 +23,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 class DpaHandler2 : public IDpaHandler2 {
 public:
@@ -30,6 +31,20 @@ public:
   virtual ~DpaHandler2();
   std::shared_ptr<IDpaTransaction2> executeDpaTransaction( const DpaMessage& request, int32_t timeout,
     IDpaTransactionResult2::ErrorCode defaultError) override;
+  std::shared_ptr<IDpaTransaction2> executeDpaTransactionAsync( const DpaMessage& request, int32_t timeout,
+    CompletionFunc onCompletion, IDpaTransactionResult2::ErrorCode defaultError ) override;
+  std::shared_ptr<IDpaTransaction2> executeDpaTransaction( const DpaMessage& request, const TransactionOptions& options ) override;
+  std::shared_ptr<IDpaTransaction2> executeDpaTransactionAsync( const DpaMessage& request, const TransactionOptions& options,
+    CompletionFunc onCompletion ) override;
+  std::shared_ptr<IDpaTransaction2> executeDpaChain( const DpaMessage& first, ContinuationFunc continuation,
+    const TransactionOptions& options, bool keepInterface ) override;
+  std::shared_ptr<IDpaTransactionGroup> executeDpaTransactions( const std::vector<DpaMessage>& requests,
+    const TransactionOptions& options ) override;
+  std::shared_ptr<IDpaPreparedTransaction> prepareDpaTransaction( const DpaMessage& request, const TransactionOptions& options ) override;
+  int cancelDpaTransactions( const std::string& serviceId ) override;
+  int cancelDpaTransactions( uint16_t nadr ) override;
+  bool isNodeReachable( uint16_t nadr ) const override;
+  void setCompletionExecutor( CompletionExecutorFunc executor ) override;
   int getTimeout() const override;
   void setTimeout( int timeout ) override;
   IDpaTransaction2::RfMode getRfCommunicationMode() const override;
@@ -43,6 +58,16 @@ public:
   int getDpaQueueLen() const override;
   void registerAnyMessageHandler(const std::string& serviceId, AnyMessageHandlerFunc fun) override;
   void unregisterAnyMessageHandler(const std::string& serviceId) override;
+  ReceiveStats getReceiveStats() const override;
+  void setAdaptiveTimeout( bool enable ) override;
+  bool getAdaptiveTimeout() const override;
+  std::map<uint16_t, TimeoutStats> getNodeTimeoutStats() const override;
+  std::map<uint8_t, TimeoutStats> getHopsTimeoutStats() const override;
+  void resetTimeoutStats() override;
+  void setReleaseResultOnResponse( bool enable ) override;
+  bool getReleaseResultOnResponse() const override;
+  void setInlineExecution( bool enable ) override;
+  bool getInlineExecution() const override;
 private:
   class Imp;
   Imp *m_imp = nullptr;
@@ -0,0 +1,638 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaJson.h"
+#include "DpaCommandTable.h"
+#include "DpaResponse.h"
+#include "DpaFields.h"
+#include <chrono>
+#include <cstring>
+
+namespace {
+  const char HEX_DIGITS[] = "0123456789abcdef";
+
+  // index of PData in request and in confirmation or response
+  const int REQUEST_DATA_INDEX = sizeof( TDpaIFaceHeader );
+  const int RESPONSE_DATA_INDEX = sizeof( TDpaIFaceHeader ) + 2;
+
+  // response structure if the response is long enough, nullptr otherwise
+  template <typename TResponse>
+  const TResponse* responseData( const DpaMessage& response )
+  {
+    if ( response.GetLength() - RESPONSE_DATA_INDEX < DpaResponseMinLength<TResponse>::value ) {
+      return nullptr;
+    }
+    return &*DpaResponseView<TResponse>( response );
+  }
+
+  int64_t toEpochMs( const std::chrono::time_point<std::chrono::system_clock>& ts )
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>( ts.time_since_epoch() ).count();
+  }
+
+  /////////////////////////////////////
+  // JSON scanner used by readMessage()
+  /////////////////////////////////////
+  class Scanner
+  {
+  public:
+    Scanner( const char* json, int length ) : m_pos( json ), m_end( json + ( length > 0 ? length : 0 ) ) {}
+
+    void skipWhitespace()
+    {
+      while ( m_pos < m_end && ( *m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r' ) ) {
+        m_pos++;
+      }
+    }
+
+    bool consume( char c )
+    {
+      skipWhitespace();
+      if ( m_pos < m_end && *m_pos == c ) {
+        m_pos++;
+        return true;
+      }
+      return false;
+    }
+
+    bool atEnd()
+    {
+      skipWhitespace();
+      return m_pos == m_end;
+    }
+
+    // string without quotes, escapes are kept as they are
+    bool string( const char*& begin, int& length )
+    {
+      if ( !consume( '"' ) ) {
+        return false;
+      }
+      begin = m_pos;
+      while ( m_pos < m_end && *m_pos != '"' ) {
+        if ( *m_pos == '\\' ) {
+          m_pos++;
+        }
+        m_pos++;
+      }
+      if ( m_pos >= m_end ) {
+        return false;
+      }
+      length = static_cast<int>( m_pos - begin );
+      m_pos++;
+      return true;
+    }
+
+    bool integer( int64_t& value )
+    {
+      skipWhitespace();
+      bool negative = m_pos < m_end && *m_pos == '-';
+      if ( negative ) {
+        m_pos++;
+      }
+      const char* begin = m_pos;
+      value = 0;
+      while ( m_pos < m_end && *m_pos >= '0' && *m_pos <= '9' && m_pos - begin < 18 ) {
+        value = value * 10 + ( *m_pos - '0' );
+        m_pos++;
+      }
+      if ( m_pos == begin || ( m_pos < m_end && *m_pos >= '0' && *m_pos <= '9' ) ) {
+        return false;
+      }
+      if ( negative ) {
+        value = -value;
+      }
+      return true;
+    }
+
+    // skip any value including nested objects and arrays
+    bool skipValue()
+    {
+      skipWhitespace();
+      if ( m_pos >= m_end ) {
+        return false;
+      }
+      if ( *m_pos == '"' ) {
+        const char* begin;
+        int length;
+        return string( begin, length );
+      }
+      if ( *m_pos == '{' || *m_pos == '[' ) {
+        int depth = 0;
+        while ( m_pos < m_end ) {
+          char c = *m_pos;
+          if ( c == '"' ) {
+            const char* begin;
+            int length;
+            if ( !string( begin, length ) ) {
+              return false;
+            }
+            continue;
+          }
+          m_pos++;
+          if ( c == '{' || c == '[' ) {
+            depth++;
+          }
+          else if ( c == '}' || c == ']' ) {
+            if ( --depth == 0 ) {
+              return true;
+            }
+          }
+        }
+        return false;
+      }
+      // number or literal
+      const char* begin = m_pos;
+      while ( m_pos < m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']' &&
+        *m_pos != ' ' && *m_pos != '\t' && *m_pos != '\n' && *m_pos != '\r' ) {
+        m_pos++;
+      }
+      return m_pos != begin;
+    }
+
+  private:
+    const char* m_pos;
+    const char* m_end;
+  };
+
+  bool keyIs( const char* key, int length, const char* name )
+  {
+    return static_cast<int>( std::strlen( name ) ) == length && std::memcmp( key, name, length ) == 0;
+  }
+
+  int hexValue( char c )
+  {
+    if ( c >= '0' && c <= '9' ) return c - '0';
+    if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+    if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+    return -1;
+  }
+}
+
+/////////////////////////////////////
+// class DpaJson::Writer
+/////////////////////////////////////
+DpaJson::Writer::Writer( char* buffer, int size )
+  : m_buffer( buffer )
+  , m_size( buffer != nullptr && size > 0 ? size : 0 )
+{
+  m_first[0] = true;
+  terminate();
+}
+
+void DpaJson::Writer::beginObject()
+{
+  separator();
+  put( '{' );
+  if ( m_depth >= MAX_DEPTH ) {
+    m_overflow = true;
+    return;
+  }
+  m_first[++m_depth] = true;
+}
+
+void DpaJson::Writer::beginObject( const char* name )
+{
+  key( name );
+  put( '{' );
+  if ( m_depth >= MAX_DEPTH ) {
+    m_overflow = true;
+    return;
+  }
+  m_first[++m_depth] = true;
+}
+
+void DpaJson::Writer::endObject()
+{
+  put( '}' );
+  if ( m_depth > 0 ) {
+    m_depth--;
+  }
+}
+
+void DpaJson::Writer::member( const char* name, int64_t value )
+{
+  key( name );
+  putInt( value );
+}
+
+void DpaJson::Writer::member( const char* name, const char* value )
+{
+  key( name );
+  putString( value );
+}
+
+void DpaJson::Writer::memberHex( const char* name, const uint8_t* data, int length )
+{
+  key( name );
+  put( '"' );
+  for ( int i = 0; i < length; i++ ) {
+    put( HEX_DIGITS[data[i] >> 4] );
+    put( HEX_DIGITS[data[i] & 0x0f] );
+  }
+  put( '"' );
+}
+
+void DpaJson::Writer::key( const char* name )
+{
+  separator();
+  putString( name );
+  put( ':' );
+}
+
+void DpaJson::Writer::separator()
+{
+  if ( m_depth > 0 ) {
+    if ( !m_first[m_depth] ) {
+      put( ',' );
+    }
+    m_first[m_depth] = false;
+  }
+}
+
+void DpaJson::Writer::put( char c )
+{
+  // keep room for terminating zero
+  if ( m_overflow || m_length + 1 >= m_size ) {
+    m_overflow = true;
+    return;
+  }
+  m_buffer[m_length++] = c;
+  m_buffer[m_length] = '\0';
+}
+
+void DpaJson::Writer::put( const char* str )
+{
+  while ( *str != '\0' ) {
+    put( *str++ );
+  }
+}
+
+void DpaJson::Writer::putString( const char* str )
+{
+  put( '"' );
+  for ( ; *str != '\0'; str++ ) {
+    unsigned char c = static_cast<unsigned char>( *str );
+    if ( c == '"' || c == '\\' ) {
+      put( '\\' );
+      put( static_cast<char>( c ) );
+    }
+    else if ( c < 0x20 ) {
+      put( "\\u00" );
+      put( HEX_DIGITS[c >> 4] );
+      put( HEX_DIGITS[c & 0x0f] );
+    }
+    else {
+      put( static_cast<char>( c ) );
+    }
+  }
+  put( '"' );
+}
+
+void DpaJson::Writer::putInt( int64_t value )
+{
+  char digits[20];
+  int count = 0;
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>( value ) : static_cast<uint64_t>( value );
+
+  do {
+    digits[count++] = static_cast<char>( '0' + magnitude % 10 );
+    magnitude /= 10;
+  } while ( magnitude != 0 );
+
+  if ( value < 0 ) {
+    put( '-' );
+  }
+  while ( count > 0 ) {
+    put( digits[--count] );
+  }
+}
+
+void DpaJson::Writer::terminate()
+{
+  if ( m_size > 0 ) {
+    m_buffer[m_length] = '\0';
+  }
+}
+
+/////////////////////////////////////
+// class DpaJson
+/////////////////////////////////////
+void DpaJson::writeMessage( Writer& writer, const char* key, const DpaMessage& message )
+{
+  if ( key != nullptr ) {
+    writer.beginObject( key );
+  }
+  else {
+    writer.beginObject();
+  }
+
+  const uint8_t* data = message.DpaPacketData();
+  int length = message.GetLength();
+
+  writer.member( "nadr", message.NodeAddress() );
+  writer.member( "pnum", message.PeripheralType() );
+  writer.member( "pcmd", message.PeripheralCommand() );
+  writer.member( "hwpid", message.Hwpid() );
+
+  int dataIndex = REQUEST_DATA_INDEX;
+  if ( message.MessageDirection() != DpaMessage::kRequest ) {
+    writer.member( "rcode", data[RESPONSE_DATA_INDEX - 2] );
+    writer.member( "dpaval", data[RESPONSE_DATA_INDEX - 1] );
+    dataIndex = RESPONSE_DATA_INDEX;
+  }
+
+  writer.memberHex( "pdata", data + dataIndex, length > dataIndex ? length - dataIndex : 0 );
+  writer.endObject();
+}
+
+void DpaJson::writeResult( Writer& writer, const char* key, const IDpaTransactionResult2& result )
+{
+  if ( key != nullptr ) {
+    writer.beginObject( key );
+  }
+  else {
+    writer.beginObject();
+  }
+
+  const DpaMessage& request = result.getRequest();
+  const DpaCommandTable::Entry* command = DpaCommandTable::get( request.PeripheralType(), request.PeripheralCommand() );
+  if ( command != nullptr ) {
+    writer.member( "command", command->name );
+  }
+
+  int errorCode = result.getErrorCode();
+  writer.member( "errorCode", errorCode );
+  const char* errorName = IDpaTransactionResult2::errorCodeName( errorCode );
+  if ( errorName != nullptr ) {
+    writer.member( "errorString", errorName );
+  }
+
+  writer.member( "requestTs", toEpochMs( result.getRequestTs() ) );
+  writeMessage( writer, "request", request );
+
+  if ( result.isConfirmed() ) {
+    writer.member( "confirmationTs", toEpochMs( result.getConfirmationTs() ) );
+    writeMessage( writer, "confirmation", result.getConfirmation() );
+  }
+
+  if ( result.isResponded() ) {
+    const DpaMessage& response = result.getResponse();
+    writer.member( "responseTs", toEpochMs( result.getResponseTs() ) );
+    writeMessage( writer, "response", response );
+    writeResponseFields( writer, response );
+  }
+
+  writer.endObject();
+}
+
+int DpaJson::writeMessage( const DpaMessage& message, char* buffer, int size )
+{
+  Writer writer( buffer, size );
+  writeMessage( writer, nullptr, message );
+  return writer.overflow() ? -1 : writer.length();
+}
+
+int DpaJson::writeResult( const IDpaTransactionResult2& result, char* buffer, int size )
+{
+  Writer writer( buffer, size );
+  writeResult( writer, nullptr, result );
+  return writer.overflow() ? -1 : writer.length();
+}
+
+void DpaJson::writeResponseFields( Writer& writer, const DpaMessage& response )
+{
+  if ( response.MessageDirection() != DpaMessage::kResponse || response.ResponseCode() != STATUS_NO_ERROR ) {
+    return;
+  }
+
+  uint8_t pnum = response.PeripheralType();
+  uint8_t pcmd = response.PeripheralCommand() & ~0x80;
+
+  if ( pcmd == CMD_GET_PER_INFO ) {
+    if ( pnum == PNUM_ENUMERATION ) {
+      if ( const TEnumPeripheralsAnswer* r = responseData<TEnumPeripheralsAnswer>( response ) ) {
+        writer.beginObject( "fields" );
+        writer.member( "dpaVersion", DpaFields::getDpaVersion( *r ) );
+        writer.member( "userPerNr", r->UserPerNr );
+        writer.member( "hwpid", DpaFields::getHWPID( *r ) );
+        writer.member( "hwpidVer", DpaFields::getHWPIDver( *r ) );
+        writer.member( "flags", r->Flags );
+        writer.endObject();
+      }
+    }
+    else if ( const TPeripheralInfoAnswer* r = responseData<TPeripheralInfoAnswer>( response ) ) {
+      writer.beginObject( "fields" );
+      writer.member( "perTe", r->PerTE );
+      writer.member( "perT", r->PerT );
+      writer.member( "par1", r->Par1 );
+      writer.member( "par2", r->Par2 );
+      writer.endObject();
+    }
+    return;
+  }
+
+  switch ( pnum ) {
+    case PNUM_COORDINATOR:
+      if ( pcmd == CMD_COORDINATOR_ADDR_INFO ) {
+        if ( const TPerCoordinatorAddrInfo_Response* r = responseData<TPerCoordinatorAddrInfo_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "devNr", r->DevNr );
+          writer.member( "did", r->DID );
+          writer.endObject();
+        }
+      }
+      else if ( pcmd == CMD_COORDINATOR_DISCOVERY ) {
+        if ( const TPerCoordinatorDiscovery_Response* r = responseData<TPerCoordinatorDiscovery_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "discNr", r->DiscNr );
+          writer.endObject();
+        }
+      }
+      else if ( pcmd == CMD_COORDINATOR_BOND_NODE || pcmd == CMD_COORDINATOR_SMART_CONNECT ) {
+        if ( const TPerCoordinatorBondNodeSmartConnect_Response* r = responseData<TPerCoordinatorBondNodeSmartConnect_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "bondAddr", r->BondAddr );
+          writer.member( "devNr", r->DevNr );
+          writer.endObject();
+        }
+      }
+      else if ( pcmd == CMD_COORDINATOR_REMOVE_BOND ) {
+        if ( const TPerCoordinatorRemoveBond_Response* r = responseData<TPerCoordinatorRemoveBond_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "devNr", r->DevNr );
+          writer.endObject();
+        }
+      }
+      break;
+
+    case PNUM_NODE:
+      if ( pcmd == CMD_NODE_READ ) {
+        if ( const TPerNodeRead_Response* r = responseData<TPerNodeRead_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "ntwAddr", r->ntwADDR );
+          writer.member( "ntwVrn", r->ntwVRN );
+          writer.member( "ntwZin", r->ntwZIN );
+          writer.member( "ntwDid", r->ntwDID );
+          writer.member( "ntwPvrn", r->ntwPVRN );
+          writer.member( "ntwUserAddress", DpaFields::getntwUSERADDRESS( *r ) );
+          writer.member( "ntwId", DpaFields::getntwID( *r ) );
+          writer.member( "ntwVrnfnz", r->ntwVRNFNZ );
+          writer.member( "ntwCfg", r->ntwCFG );
+          writer.member( "flags", r->Flags );
+          writer.endObject();
+        }
+      }
+      break;
+
+    case PNUM_OS:
+      if ( pcmd == CMD_OS_READ ) {
+        if ( const TPerOSRead_Response* r = responseData<TPerOSRead_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.memberHex( "mid", r->MID, sizeof( r->MID ) );
+          writer.member( "osVersion", r->OsVersion );
+          writer.member( "mcuType", r->McuType );
+          writer.member( "osBuild", DpaFields::getOsBuild( *r ) );
+          writer.member( "rssi", r->Rssi );
+          writer.member( "supplyVoltage", r->SupplyVoltage );
+          writer.member( "flags", r->Flags );
+          writer.member( "slotLimits", r->SlotLimits );
+          writer.member( "dpaVersion", DpaFields::getDpaVersion( *r ) );
+          writer.member( "userPerNr", r->UserPerNr );
+          writer.member( "hwpid", DpaFields::getHWPID( *r ) );
+          writer.member( "hwpidVer", DpaFields::getHWPIDver( *r ) );
+          writer.endObject();
+        }
+      }
+      break;
+
+    case PNUM_THERMOMETER:
+      if ( pcmd == CMD_THERMOMETER_READ ) {
+        if ( const TPerThermometerRead_Response* r = responseData<TPerThermometerRead_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "integerValue", r->IntegerValue );
+          writer.member( "sixteenthValue", DpaFields::getSixteenthValue( *r ) );
+          writer.endObject();
+        }
+      }
+      break;
+
+    case PNUM_FRC:
+      if ( pcmd == CMD_FRC_SEND || pcmd == CMD_FRC_SEND_SELECTIVE ) {
+        if ( const TPerFrcSend_Response* r = responseData<TPerFrcSend_Response>( response ) ) {
+          writer.beginObject( "fields" );
+          writer.member( "status", r->Status );
+          writer.endObject();
+        }
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool DpaJson::readMessage( const char* json, int length, DpaMessage& message )
+{
+  if ( json == nullptr ) {
+    return false;
+  }
+
+  Scanner scanner( json, length );
+  int64_t nadr = -1, pnum = -1, pcmd = -1, hwpid = HWPID_DoNotCheck, rcode = -1, dpaval = 0;
+  uint8_t pdata[DpaMessage::kMaxDpaMessageSize];
+  int pdataLength = 0;
+
+  if ( !scanner.consume( '{' ) ) {
+    return false;
+  }
+
+  if ( !scanner.consume( '}' ) ) {
+    do {
+      const char* key;
+      int keyLength;
+      if ( !scanner.string( key, keyLength ) || !scanner.consume( ':' ) ) {
+        return false;
+      }
+
+      bool ok = true;
+      if ( keyIs( key, keyLength, "nadr" ) ) {
+        ok = scanner.integer( nadr ) && nadr >= 0 && nadr <= 0xffff;
+      }
+      else if ( keyIs( key, keyLength, "pnum" ) ) {
+        ok = scanner.integer( pnum ) && pnum >= 0 && pnum <= 0xff;
+      }
+      else if ( keyIs( key, keyLength, "pcmd" ) ) {
+        ok = scanner.integer( pcmd ) && pcmd >= 0 && pcmd <= 0xff;
+      }
+      else if ( keyIs( key, keyLength, "hwpid" ) ) {
+        ok = scanner.integer( hwpid ) && hwpid >= 0 && hwpid <= 0xffff;
+      }
+      else if ( keyIs( key, keyLength, "rcode" ) ) {
+        ok = scanner.integer( rcode ) && rcode >= 0 && rcode <= 0xff;
+      }
+      else if ( keyIs( key, keyLength, "dpaval" ) ) {
+        ok = scanner.integer( dpaval ) && dpaval >= 0 && dpaval <= 0xff;
+      }
+      else if ( keyIs( key, keyLength, "pdata" ) ) {
+        const char* hex;
+        int hexLength;
+        ok = scanner.string( hex, hexLength ) && hexLength % 2 == 0 && hexLength / 2 <= DpaMessage::kMaxDpaMessageSize;
+        for ( int i = 0; ok && i < hexLength; i += 2 ) {
+          int hi = hexValue( hex[i] );
+          int lo = hexValue( hex[i + 1] );
+          ok = hi >= 0 && lo >= 0;
+          pdata[i / 2] = static_cast<uint8_t>( ( hi << 4 ) | lo );
+        }
+        pdataLength = hexLength / 2;
+      }
+      else {
+        ok = scanner.skipValue();
+      }
+
+      if ( !ok ) {
+        return false;
+      }
+    } while ( scanner.consume( ',' ) );
+
+    if ( !scanner.consume( '}' ) ) {
+      return false;
+    }
+  }
+
+  if ( !scanner.atEnd() || nadr < 0 || pnum < 0 || pcmd < 0 ) {
+    return false;
+  }
+
+  int dataIndex = rcode >= 0 ? RESPONSE_DATA_INDEX : REQUEST_DATA_INDEX;
+  if ( dataIndex + pdataLength > DpaMessage::kMaxDpaMessageSize ) {
+    return false;
+  }
+
+  uint8_t buffer[DpaMessage::kMaxDpaMessageSize];
+  DpaEndian::storeLe16( buffer, static_cast<uint16_t>( nadr ) );
+  buffer[2] = static_cast<uint8_t>( pnum );
+  buffer[3] = static_cast<uint8_t>( pcmd );
+  DpaEndian::storeLe16( buffer + 4, static_cast<uint16_t>( hwpid ) );
+  if ( rcode >= 0 ) {
+    buffer[RESPONSE_DATA_INDEX - 2] = static_cast<uint8_t>( rcode );
+    buffer[RESPONSE_DATA_INDEX - 1] = static_cast<uint8_t>( dpaval );
+  }
+  std::memcpy( buffer + dataIndex, pdata, pdataLength );
+
+  message.DataToBuffer( buffer, static_cast<uint8_t>( dataIndex + pdataLength ) );
+  return true;
+}
@@ -0,0 +1,113 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "IDpaTransactionResult2.h"
+#include "DpaMessage.h"
+#include <cstdint>
+
+/// \class DpaJson
+/// \brief Allocation free JSON encoding of DPA messages and transaction results
+/// \details
+/// The JSON is written directly to a buffer supplied by caller, there is no intermediate DOM.
+/// A message is encoded as:
+/// \code
+/// {"nadr":1,"pnum":2,"pcmd":128,"hwpid":65535,"rcode":0,"dpaval":64,"pdata":"0a1b2c"}
+/// \endcode
+/// where rcode and dpaval are present for confirmations and responses only. A transaction result
+/// is an object with the command name from DpaCommandTable, error code and string, timestamps
+/// (milliseconds since epoch) and the messages. Known responses have also "fields" object with
+/// decoded values of the response structure from DPA.h.
+///
+/// The reader parses a message object back to DpaMessage. Unknown keys are skipped.
+class DpaJson
+{
+public:
+  /// \class Writer
+  /// \brief Sequential JSON writer to a fixed buffer
+  /// \details
+  /// Commas between members are inserted automatically. If the buffer is too small the writer
+  /// stops writing and overflow() returns true. The output is zero terminated if there is a room.
+  class Writer
+  {
+  public:
+    /// maximal depth of nested objects
+    static const int MAX_DEPTH = 8;
+
+    Writer( char* buffer, int size );
+
+    void beginObject();
+    void beginObject( const char* key );
+    void endObject();
+
+    void member( const char* key, int64_t value );
+    void member( const char* key, const char* value );
+    void memberHex( const char* key, const uint8_t* data, int length );
+
+    /// \return number of written characters
+    int length() const { return m_length; }
+    /// \return true if the buffer was too small
+    bool overflow() const { return m_overflow; }
+
+  private:
+    void key( const char* key );
+    void separator();
+    void put( char c );
+    void put( const char* str );
+    void putString( const char* str );
+    void putInt( int64_t value );
+    void terminate();
+
+    char* m_buffer;
+    int m_size;
+    int m_length = 0;
+    int m_depth = 0;
+    bool m_overflow = false;
+    bool m_first[MAX_DEPTH + 1];
+  };
+
+  /// \brief Write message as JSON object
+  /// \param [in,out] writer output
+  /// \param [in] key member name or nullptr for top level object
+  /// \param [in] message DPA message
+  static void writeMessage( Writer& writer, const char* key, const DpaMessage& message );
+
+  /// \brief Write transaction result as JSON object
+  /// \param [in,out] writer output
+  /// \param [in] key member name or nullptr for top level object
+  /// \param [in] result transaction result
+  static void writeResult( Writer& writer, const char* key, const IDpaTransactionResult2& result );
+
+  /// \brief Write message to buffer
+  /// \return length of JSON or -1 if the buffer is too small
+  static int writeMessage( const DpaMessage& message, char* buffer, int size );
+
+  /// \brief Write transaction result to buffer
+  /// \return length of JSON or -1 if the buffer is too small
+  static int writeResult( const IDpaTransactionResult2& result, char* buffer, int size );
+
+  /// \brief Parse message from JSON object
+  /// \param [in] json JSON text
+  /// \param [in] length JSON text length
+  /// \param [out] message parsed message, unchanged if the parsing fails
+  /// \return true if the JSON is a valid message object
+  static bool readMessage( const char* json, int length, DpaMessage& message );
+
+private:
+  static void writeResponseFields( Writer& writer, const DpaMessage& response );
+};
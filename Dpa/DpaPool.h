@@ -0,0 +1,155 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+/// \class DpaPool
+/// \brief Thread safe pool of fixed size memory blocks
+/// \details
+/// Blocks are carved from chunks of BLOCKS_PER_CHUNK blocks allocated on heap. Released blocks go to a free
+/// list and they are reused, chunks are never freed, so a steady stream of allocations of the same size
+/// doesn't touch the heap once the pool reaches its peak. There is one pool per block size, it is never
+/// destroyed so blocks can be released even during static destruction.
+template <size_t BlockSize>
+class DpaPool
+{
+public:
+  static const size_t BLOCKS_PER_CHUNK = 32;
+
+  /// counters of the pool
+  struct Stats {
+    /// heap allocations of chunks
+    uint64_t chunks;
+    /// blocks taken from the pool
+    uint64_t allocated;
+    /// blocks returned to the pool
+    uint64_t released;
+  };
+
+  static void* allocate()
+  {
+    return instance().allocateBlock();
+  }
+
+  static void deallocate( void* block )
+  {
+    if ( block != nullptr ) {
+      instance().deallocateBlock( block );
+    }
+  }
+
+  static Stats getStats()
+  {
+    DpaPool& pool = instance();
+    std::lock_guard<std::mutex> lck( pool.m_mutex );
+    return pool.m_stats;
+  }
+
+private:
+  // blocks are aligned as memory from operator new and they can hold the free list link
+  static const size_t ALIGNMENT = alignof( std::max_align_t );
+  static const size_t BLOCK_SIZE = ( ( BlockSize > sizeof( void* ) ? BlockSize : sizeof( void* ) ) + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  DpaPool() = default;
+
+  static DpaPool& instance()
+  {
+    // intentionally leaked, see class description
+    static DpaPool* pool = new DpaPool();
+    return *pool;
+  }
+
+  void* allocateBlock()
+  {
+    std::lock_guard<std::mutex> lck( m_mutex );
+    if ( m_free == nullptr ) {
+      unsigned char* chunk = static_cast<unsigned char*>( ::operator new( BLOCK_SIZE * BLOCKS_PER_CHUNK ) );
+      for ( size_t i = BLOCKS_PER_CHUNK; i > 0; i-- ) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>( chunk + ( i - 1 ) * BLOCK_SIZE );
+        block->next = m_free;
+        m_free = block;
+      }
+      m_stats.chunks++;
+    }
+    FreeBlock* block = m_free;
+    m_free = block->next;
+    m_stats.allocated++;
+    return block;
+  }
+
+  void deallocateBlock( void* block )
+  {
+    std::lock_guard<std::mutex> lck( m_mutex );
+    FreeBlock* freeBlock = static_cast<FreeBlock*>( block );
+    freeBlock->next = m_free;
+    m_free = freeBlock;
+    m_stats.released++;
+  }
+
+  std::mutex m_mutex;
+  FreeBlock* m_free = nullptr;
+  Stats m_stats = { 0, 0, 0 };
+};
+
+/// \class DpaPoolAllocator
+/// \brief Allocator taking single objects from DpaPool
+/// \details
+/// It is intended for std::allocate_shared(), so the object and its control block are a single pool block.
+/// Arrays are allocated on heap.
+template <typename T>
+class DpaPoolAllocator
+{
+public:
+  typedef T value_type;
+
+  DpaPoolAllocator() {}
+  template <typename U>
+  DpaPoolAllocator( const DpaPoolAllocator<U>& ) {}
+
+  T* allocate( size_t n )
+  {
+    static_assert( alignof( T ) <= alignof( std::max_align_t ), "Over-aligned type." );
+    if ( n == 1 ) {
+      return static_cast<T*>( DpaPool<sizeof( T )>::allocate() );
+    }
+    return static_cast<T*>( ::operator new( n * sizeof( T ) ) );
+  }
+
+  void deallocate( T* p, size_t n )
+  {
+    if ( n == 1 ) {
+      DpaPool<sizeof( T )>::deallocate( p );
+    }
+    else {
+      ::operator delete( p );
+    }
+  }
+
+  template <typename U>
+  bool operator==( const DpaPoolAllocator<U>& ) const { return true; }
+  template <typename U>
+  bool operator!=( const DpaPoolAllocator<U>& ) const { return false; }
+};
@@ -0,0 +1,135 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaTimeoutEstimator.h"
+#include "IDpaTransaction2.h"
+#include <algorithm>
+
+const int32_t DpaTimeoutEstimator::MAX_TIMEOUT_MS;
+
+/////////////////////////////////////
+// class DpaTimeoutEstimator::Series
+/////////////////////////////////////
+void DpaTimeoutEstimator::Series::add( int32_t durationMs )
+{
+  durationMs = std::min( durationMs, MAX_TIMEOUT_MS );
+  m_samples[m_next] = durationMs;
+  m_next = ( m_next + 1 ) % WINDOW_SIZE;
+
+  if ( m_stats.count == 0 ) {
+    m_stats.ewmaMs = durationMs;
+  }
+  else {
+    // alpha 1/8 as used for round trip time estimation
+    m_stats.ewmaMs += ( durationMs - m_stats.ewmaMs ) / 8;
+  }
+  m_stats.count++;
+  m_stats.lastMs = durationMs;
+  m_stats.lastTimedOut = false;
+
+  // percentile is updated here as the series is estimated more often than recorded
+  int size = static_cast<int>( std::min<uint32_t>( m_stats.count, WINDOW_SIZE ) );
+  int32_t sorted[WINDOW_SIZE];
+  std::copy( m_samples, m_samples + size, sorted );
+  int index = ( size * 95 + 99 ) / 100 - 1;
+  std::nth_element( sorted, sorted + index, sorted + size );
+  m_stats.p95Ms = sorted[index];
+}
+
+void DpaTimeoutEstimator::Series::addTimeout( int32_t elapsedMs )
+{
+  // the response takes longer than elapsed, twice of it backs off as retransmission timeout does
+  add( static_cast<int32_t>( std::min<int64_t>( static_cast<int64_t>( elapsedMs ) * 2, MAX_TIMEOUT_MS ) ) );
+  m_stats.timeouts++;
+  m_stats.lastTimedOut = true;
+}
+
+/////////////////////////////////////
+// class DpaTimeoutEstimator
+/////////////////////////////////////
+void DpaTimeoutEstimator::record( uint16_t nadr, uint8_t hops, int32_t durationMs )
+{
+  if ( durationMs < 0 ) {
+    return;
+  }
+  std::lock_guard<std::mutex> lck( m_mutex );
+  m_nodes[nadr].add( durationMs );
+  m_hops[hops].add( durationMs );
+}
+
+void DpaTimeoutEstimator::recordTimeout( uint16_t nadr, int32_t elapsedMs )
+{
+  if ( elapsedMs < 0 ) {
+    return;
+  }
+  // just the node is slow, other nodes with the same hop count are not affected
+  std::lock_guard<std::mutex> lck( m_mutex );
+  m_nodes[nadr].addTimeout( elapsedMs );
+}
+
+int32_t DpaTimeoutEstimator::estimate( uint16_t nadr, uint8_t hops, bool* lastTimedOut ) const
+{
+  std::lock_guard<std::mutex> lck( m_mutex );
+
+  const Series* series = nullptr;
+  auto node = m_nodes.find( nadr );
+  auto hopsSeries = m_hops.find( hops );
+  if ( node != m_nodes.end() && node->second.stats().count >= MIN_SAMPLES ) {
+    series = &node->second;
+  }
+  else if ( hopsSeries != m_hops.end() && hopsSeries->second.stats().count >= MIN_SAMPLES ) {
+    series = &hopsSeries->second;
+  }
+  if ( lastTimedOut != nullptr ) {
+    // the node timed out even if its history is too short to be used
+    *lastTimedOut = node != m_nodes.end() && node->second.stats().lastTimedOut;
+  }
+  return series != nullptr ? estimate( *series ) : -1;
+}
+
+int32_t DpaTimeoutEstimator::estimate( const Series& series )
+{
+  int64_t learned = std::max( series.stats().ewmaMs, series.stats().p95Ms );
+  return static_cast<int32_t>( std::min<int64_t>( learned + learned / 4 + IDpaTransaction2::SAFETY_TIMEOUT_MS, MAX_TIMEOUT_MS ) );
+}
+
+std::map<uint16_t, DpaTimeoutEstimator::Stats> DpaTimeoutEstimator::getNodeStats() const
+{
+  std::lock_guard<std::mutex> lck( m_mutex );
+  std::map<uint16_t, Stats> stats;
+  for ( const auto& it : m_nodes ) {
+    stats.insert( std::make_pair( it.first, it.second.stats() ) );
+  }
+  return stats;
+}
+
+std::map<uint8_t, DpaTimeoutEstimator::Stats> DpaTimeoutEstimator::getHopsStats() const
+{
+  std::lock_guard<std::mutex> lck( m_mutex );
+  std::map<uint8_t, Stats> stats;
+  for ( const auto& it : m_hops ) {
+    stats.insert( std::make_pair( it.first, it.second.stats() ) );
+  }
+  return stats;
+}
+
+void DpaTimeoutEstimator::reset()
+{
+  std::lock_guard<std::mutex> lck( m_mutex );
+  m_nodes.clear();
+  m_hops.clear();
+}
@@ -0,0 +1,102 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "IDpaHandler2.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+/// \class DpaTimeoutEstimator
+/// \brief Learns confirmation to response time of nodes
+/// \details
+/// The time between confirmation and response of a transaction is recorded per node address and
+/// per hop count from the confirmation. Each series keeps EWMA (alpha 1/8) and the 95th percentile
+/// of the last WINDOW_SIZE samples. The estimate is taken from the node series and from the hop count
+/// series if the node has not enough history yet. If neither has MIN_SAMPLES samples, there is no estimate
+/// and the caller uses the formulas based on the confirmation.
+///
+/// A timeout after confirmation is a censored sample, the response takes longer than the time waited.
+/// It is recorded to the node series as twice the time waited, so repeated timeouts grow the estimate
+/// exponentially and it decays back as the responses push the sample out of the window.
+/// The samples and the estimate are limited by MAX_TIMEOUT_MS, so a node timing out repeatedly
+/// doesn't hold the queue without bound.
+///
+/// The methods are thread safe.
+class DpaTimeoutEstimator
+{
+public:
+  typedef IDpaHandler2::TimeoutStats Stats;
+
+  /// number of samples used for the percentile
+  static const int WINDOW_SIZE = 32;
+  /// number of samples needed before the series is used for the estimate
+  static const int MIN_SAMPLES = 4;
+  /// upper limit of a recorded sample and of the estimate, covers the longest routed transaction
+  static const int32_t MAX_TIMEOUT_MS = 60000;
+
+  /// \brief Record observed confirmation to response time
+  /// \param [in] nadr node address
+  /// \param [in] hops hops of the request from the confirmation
+  /// \param [in] durationMs confirmation to response time
+  void record( uint16_t nadr, uint8_t hops, int32_t durationMs );
+
+  /// \brief Record transaction timed out after confirmation
+  /// \param [in] nadr node address
+  /// \param [in] elapsedMs time waited from the confirmation
+  void recordTimeout( uint16_t nadr, int32_t elapsedMs );
+
+  /// \brief Estimate confirmation to response time
+  /// \details
+  /// The estimate is the greater of EWMA and the 95th percentile, increased by a quarter and SAFETY_TIMEOUT_MS,
+  /// limited by MAX_TIMEOUT_MS.
+  /// \param [in] nadr node address
+  /// \param [in] hops hops of the request from the confirmation
+  /// \param [out] lastTimedOut set to true if the last transaction of the series used timed out, can be nullptr
+  /// \return estimated time in ms or -1 if there is not enough history
+  int32_t estimate( uint16_t nadr, uint8_t hops, bool* lastTimedOut = nullptr ) const;
+
+  /// \brief Get learned statistics of nodes
+  std::map<uint16_t, Stats> getNodeStats() const;
+
+  /// \brief Get learned statistics of hop counts
+  std::map<uint8_t, Stats> getHopsStats() const;
+
+  /// \brief Forget all learned statistics
+  void reset();
+
+private:
+  class Series
+  {
+  public:
+    void add( int32_t durationMs );
+    void addTimeout( int32_t elapsedMs );
+    const Stats& stats() const { return m_stats; }
+
+  private:
+    int32_t m_samples[WINDOW_SIZE];
+    int m_next = 0;
+    Stats m_stats;
+  };
+
+  static int32_t estimate( const Series& series );
+
+  mutable std::mutex m_mutex;
+  std::map<uint16_t, Series> m_nodes;
+  std::map<uint8_t, Series> m_hops;
+};
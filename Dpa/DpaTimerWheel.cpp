@@ -0,0 +1,330 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaTimerWheel.h"
+#include "IqrfTrace.h"
+#include <exception>
+#include <limits>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+DpaTimerWheel::DpaTimerWheel()
+  : m_start( Clock::now() )
+{
+  for ( int level = 0; level < LEVELS; level++ ) {
+    for ( int slot = 0; slot < SLOTS; slot++ ) {
+      m_heads[level][slot] = NIL;
+    }
+    m_bitmaps[level] = 0;
+  }
+  m_thread = std::thread( &DpaTimerWheel::worker, this );
+}
+
+DpaTimerWheel::~DpaTimerWheel()
+{
+  stop();
+}
+
+void DpaTimerWheel::stop()
+{
+  {
+    std::unique_lock<std::mutex> lck( m_mutex );
+    m_run = false;
+  }
+  m_conditionVariable.notify_all();
+  if ( m_thread.joinable() ) {
+    if ( m_thread.get_id() == std::this_thread::get_id() ) {
+      // stopped from a timer function, the worker finishes after it returns
+      m_thread.detach();
+    }
+    else {
+      m_thread.join();
+    }
+  }
+}
+
+DpaTimerWheel::TimerId DpaTimerWheel::schedule( Clock::time_point deadline, TimerFunc func )
+{
+  return schedule( deadline, std::weak_ptr<void>(), false, std::move( func ) );
+}
+
+DpaTimerWheel::TimerId DpaTimerWheel::schedule( Clock::time_point deadline, std::weak_ptr<void> owner, TimerFunc func )
+{
+  return schedule( deadline, std::move( owner ), true, std::move( func ) );
+}
+
+DpaTimerWheel::TimerId DpaTimerWheel::schedule( Clock::time_point deadline, std::weak_ptr<void> owner, bool hasOwner, TimerFunc func )
+{
+  std::unique_lock<std::mutex> lck( m_mutex );
+  if ( !m_run ) {
+    return 0;
+  }
+
+  uint32_t index = m_free;
+  if ( index != NIL ) {
+    m_free = m_timers[index].next;
+  }
+  else {
+    index = static_cast<uint32_t>( m_timers.size() );
+    m_timers.push_back( Timer() );
+  }
+
+  Timer& timer = m_timers[index];
+  timer.func = std::move( func );
+  timer.owner = std::move( owner );
+  timer.hasOwner = hasOwner;
+  // current tick is processed already
+  timer.expiry = std::max( toTick( deadline ), m_currentTick + 1 );
+  timer.generation++;
+  timer.pending = true;
+  insert( index );
+  m_size++;
+
+  // the worker may sleep longer than the new timer
+  if ( timer.expiry < m_wakeTick ) {
+    m_changed = true;
+    m_conditionVariable.notify_all();
+  }
+
+  return ( static_cast<uint64_t>( timer.generation ) << 32 ) | index;
+}
+
+bool DpaTimerWheel::cancel( TimerId id )
+{
+  uint32_t index = static_cast<uint32_t>( id & 0xffffffff );
+  uint32_t generation = static_cast<uint32_t>( id >> 32 );
+
+  std::unique_lock<std::mutex> lck( m_mutex );
+
+  if ( index >= m_timers.size() || m_timers[index].generation != generation || !m_timers[index].pending ) {
+    return false;
+  }
+
+  Timer& timer = m_timers[index];
+  unlink( index );
+  timer.pending = false;
+  timer.func = nullptr;
+  timer.owner.reset();
+  timer.next = m_free;
+  m_free = index;
+  m_size--;
+  return true;
+}
+
+size_t DpaTimerWheel::size() const
+{
+  std::unique_lock<std::mutex> lck( m_mutex );
+  return m_size;
+}
+
+uint64_t DpaTimerWheel::toTick( Clock::time_point time ) const
+{
+  if ( time <= m_start ) {
+    return 0;
+  }
+  // rounded up, the timer never expires before its deadline
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>( time - m_start ).count();
+  return static_cast<uint64_t>( ( us + 999 ) / 1000 );
+}
+
+void DpaTimerWheel::insert( uint32_t index )
+{
+  Timer& timer = m_timers[index];
+  uint64_t delta = timer.expiry - m_currentTick;
+
+  int level = 0;
+  while ( level < LEVELS - 1 && delta >= ( static_cast<uint64_t>( 1 ) << ( SLOT_BITS * ( level + 1 ) ) ) ) {
+    level++;
+  }
+
+  uint64_t expiry = timer.expiry;
+  if ( delta >= ( static_cast<uint64_t>( 1 ) << ( SLOT_BITS * LEVELS ) ) ) {
+    // out of the wheel range, it is placed to the last slot and cascaded again
+    expiry = m_currentTick + ( static_cast<uint64_t>( 1 ) << ( SLOT_BITS * LEVELS ) ) - 1;
+  }
+
+  int slot = static_cast<int>( ( expiry >> ( SLOT_BITS * level ) ) & ( SLOTS - 1 ) );
+  timer.level = static_cast<uint8_t>( level );
+  timer.slot = static_cast<uint8_t>( slot );
+  timer.prev = NIL;
+  timer.next = m_heads[level][slot];
+  if ( timer.next != NIL ) {
+    m_timers[timer.next].prev = index;
+  }
+  m_heads[level][slot] = index;
+  m_bitmaps[level] |= static_cast<uint64_t>( 1 ) << slot;
+}
+
+void DpaTimerWheel::unlink( uint32_t index )
+{
+  Timer& timer = m_timers[index];
+  if ( timer.prev != NIL ) {
+    m_timers[timer.prev].next = timer.next;
+  }
+  else {
+    m_heads[timer.level][timer.slot] = timer.next;
+  }
+  if ( timer.next != NIL ) {
+    m_timers[timer.next].prev = timer.prev;
+  }
+  if ( m_heads[timer.level][timer.slot] == NIL ) {
+    m_bitmaps[timer.level] &= ~( static_cast<uint64_t>( 1 ) << timer.slot );
+  }
+}
+
+void DpaTimerWheel::cascade( int level, int slot )
+{
+  uint32_t index = m_heads[level][slot];
+  m_heads[level][slot] = NIL;
+  m_bitmaps[level] &= ~( static_cast<uint64_t>( 1 ) << slot );
+
+  while ( index != NIL ) {
+    uint32_t next = m_timers[index].next;
+    insert( index );
+    index = next;
+  }
+}
+
+void DpaTimerWheel::expire( int slot, std::vector<Expired>& expired )
+{
+  uint32_t index = m_heads[0][slot];
+  m_heads[0][slot] = NIL;
+  m_bitmaps[0] &= ~( static_cast<uint64_t>( 1 ) << slot );
+
+  while ( index != NIL ) {
+    Timer& timer = m_timers[index];
+    uint32_t next = timer.next;
+    Expired item = { std::move( timer.func ), std::move( timer.owner ), timer.hasOwner };
+    expired.push_back( std::move( item ) );
+    timer.func = nullptr;
+    timer.owner.reset();
+    timer.pending = false;
+    timer.next = m_free;
+    m_free = index;
+    m_size--;
+    index = next;
+  }
+}
+
+uint64_t DpaTimerWheel::nextTick() const
+{
+  uint64_t tick = std::numeric_limits<uint64_t>::max();
+
+  for ( int level = 0; level < LEVELS; level++ ) {
+    uint64_t bitmap = m_bitmaps[level];
+    if ( bitmap == 0 ) {
+      continue;
+    }
+    // the first non-empty slot after the current one, the current slot of level > 0 is the last one
+    uint64_t position = m_currentTick >> ( SLOT_BITS * level );
+    int shift = static_cast<int>( ( position + 1 ) & ( SLOTS - 1 ) );
+    uint64_t rotated = shift == 0 ? bitmap : ( bitmap >> shift ) | ( bitmap << ( SLOTS - shift ) );
+    uint64_t distance = static_cast<uint64_t>( countTrailingZeros( rotated ) ) + 1;
+    uint64_t slotTick = ( position + distance ) << ( SLOT_BITS * level );
+    if ( slotTick < tick ) {
+      tick = slotTick;
+    }
+  }
+
+  return tick;
+}
+
+void DpaTimerWheel::advance( uint64_t tick, std::vector<Expired>& expired )
+{
+  while ( m_currentTick < tick ) {
+    uint64_t next = nextTick();
+    if ( next > tick ) {
+      // no slot to process up to tick
+      m_currentTick = tick;
+      break;
+    }
+    m_currentTick = next;
+
+    // higher levels are cascaded when lower levels wrap, the timers go down to level 0 eventually
+    for ( int level = LEVELS - 1; level > 0; level-- ) {
+      uint64_t mask = ( static_cast<uint64_t>( 1 ) << ( SLOT_BITS * level ) ) - 1;
+      if ( ( m_currentTick & mask ) == 0 ) {
+        cascade( level, static_cast<int>( ( m_currentTick >> ( SLOT_BITS * level ) ) & ( SLOTS - 1 ) ) );
+      }
+    }
+    expire( static_cast<int>( m_currentTick & ( SLOTS - 1 ) ), expired );
+  }
+}
+
+void DpaTimerWheel::worker()
+{
+  // kept over the loop, so its capacity is reused
+  std::vector<Expired> expired;
+  std::unique_lock<std::mutex> lck( m_mutex );
+
+  while ( m_run ) {
+    // ticks fully elapsed till now
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( Clock::now() - m_start ).count();
+    advance( static_cast<uint64_t>( elapsed ), expired );
+
+    if ( !expired.empty() ) {
+      lck.unlock();
+      for ( auto& item : expired ) {
+        try {
+          // owner is kept alive while its function runs
+          std::shared_ptr<void> owner = item.owner.lock();
+          if ( owner || !item.hasOwner ) {
+            item.func();
+          }
+        }
+        catch ( std::exception& e ) {
+          CATCH_EXC_TRC_WAR( std::exception, e, "Timer function error: " );
+        }
+      }
+      expired.clear();
+      lck.lock();
+      continue;
+    }
+
+    m_changed = false;
+    uint64_t tick = nextTick();
+    m_wakeTick = tick;
+    if ( tick == std::numeric_limits<uint64_t>::max() ) {
+      m_conditionVariable.wait( lck, [&] { return m_changed || !m_run; } );
+    }
+    else {
+      m_conditionVariable.wait_until( lck, m_start + std::chrono::milliseconds( tick ), [&] { return m_changed || !m_run; } );
+    }
+    // timers scheduled meanwhile are found by nextTick()
+    m_wakeTick = 0;
+  }
+}
+
+int DpaTimerWheel::countTrailingZeros( uint64_t x )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+  return __builtin_ctzll( x );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+  unsigned long index;
+  _BitScanForward64( &index, x );
+  return static_cast<int>( index );
+#else
+  int n = 0;
+  while ( ( x & 1 ) == 0 ) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
@@ -0,0 +1,144 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// \class DpaTimerWheel
+/// \brief Hierarchical timer wheel driving transaction deadlines
+/// \details
+/// Timers are scheduled to absolute deadlines of the steady clock with 1 ms resolution. The wheel has
+/// LEVELS levels of SLOTS slots, a slot of level L covers SLOTS^L ms, so the wheel spans about 4.6 hours
+/// and later deadlines are cascaded down repeatedly. Each slot is an intrusive list of timers and each
+/// level has a bitmap of non-empty slots, so schedule() and cancel() are O(1) and the worker thread
+/// sleeps until the next non-empty slot instead of ticking.
+///
+/// Timer functions are called by the worker thread out of the wheel lock. A function can be still called
+/// after cancel() returned false, i.e. when the timer already expired, so the function has to check
+/// its own state.
+class DpaTimerWheel
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+  /// identification of scheduled timer, 0 is never used
+  typedef uint64_t TimerId;
+  /// function called when timer expires
+  typedef std::function<void()> TimerFunc;
+
+  static const int LEVELS = 4;
+  static const int SLOTS = 64;
+
+  /// starts the worker thread
+  DpaTimerWheel();
+  /// stops the worker thread, pending timers are dropped
+  ~DpaTimerWheel();
+
+  DpaTimerWheel( const DpaTimerWheel& ) = delete;
+  DpaTimerWheel& operator=( const DpaTimerWheel& ) = delete;
+
+  /// \brief Schedule timer
+  /// \param [in] deadline absolute time of expiration, past deadline expires as soon as possible
+  /// \param [in] func function called when the timer expires
+  /// \return timer identification used by cancel(), 0 if the wheel is stopped
+  TimerId schedule( Clock::time_point deadline, TimerFunc func );
+
+  /// \brief Schedule timer of an object owned by std::shared_ptr
+  /// \details
+  /// The owner is locked while the function is called and the function is not called if the owner
+  /// has been destroyed. So the function can capture raw pointer to the owner and it fits
+  /// to small buffer of std::function without heap allocation.
+  /// \param [in] deadline absolute time of expiration, past deadline expires as soon as possible
+  /// \param [in] owner object the function works with
+  /// \param [in] func function called when the timer expires
+  /// \return timer identification used by cancel(), 0 if the wheel is stopped
+  TimerId schedule( Clock::time_point deadline, std::weak_ptr<void> owner, TimerFunc func );
+
+  /// \brief Cancel timer
+  /// \param [in] id timer identification
+  /// \return true if the timer was pending and it is cancelled, false if it already expired
+  bool cancel( TimerId id );
+
+  /// \brief Get number of pending timers
+  size_t size() const;
+
+  /// \brief Stop the worker thread
+  /// \details
+  /// It waits for a running timer function. No timer expires after the call, pending timers are dropped
+  /// by the destructor and schedule() returns 0.
+  void stop();
+
+private:
+  static const uint32_t NIL = 0xffffffff;
+  static const int SLOT_BITS = 6;
+
+  struct Timer {
+    TimerFunc func;
+    std::weak_ptr<void> owner;
+    bool hasOwner = false;
+    uint64_t expiry = 0;
+    uint32_t prev = NIL;
+    uint32_t next = NIL;
+    uint32_t generation = 0;
+    uint8_t level = 0;
+    uint8_t slot = 0;
+    bool pending = false;
+  };
+
+  uint64_t toTick( Clock::time_point time ) const;
+  void insert( uint32_t index );
+  void unlink( uint32_t index );
+  void cascade( int level, int slot );
+  struct Expired {
+    TimerFunc func;
+    std::weak_ptr<void> owner;
+    bool hasOwner;
+  };
+
+  TimerId schedule( Clock::time_point deadline, std::weak_ptr<void> owner, bool hasOwner, TimerFunc func );
+  void expire( int slot, std::vector<Expired>& expired );
+  // tick of the next slot to be processed, UINT64_MAX if there is no timer
+  uint64_t nextTick() const;
+  void advance( uint64_t tick, std::vector<Expired>& expired );
+  void worker();
+
+  static int countTrailingZeros( uint64_t x );
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_conditionVariable;
+  Clock::time_point m_start;
+  /// last processed tick
+  uint64_t m_currentTick = 0;
+  /// timers and free list of the timers, index of timer is part of TimerId
+  std::vector<Timer> m_timers;
+  uint32_t m_free = NIL;
+  size_t m_size = 0;
+  uint32_t m_heads[LEVELS][SLOTS];
+  uint64_t m_bitmaps[LEVELS];
+  bool m_run = true;
+  bool m_changed = false;
+  /// tick the worker sleeps until, 0 while it is not sleeping, later timers don't wake it
+  uint64_t m_wakeTick = 0;
+  std::thread m_thread;
+};
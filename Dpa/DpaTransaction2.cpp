@@ -20,6 +20,7 @@
 #include "DpaTransaction2.h"
 #include "DpaTransactionResult2.h"
 #include "DpaMessage.h"
+#include "DpaCommandTable.h"
 #include "IqrfTrace.h"
 #include "IChannel.h"
 #include <iostream>
@@ -48,69 +49,49 @@ using namespace std;
 // The function computes expected time set appropriate transaction state and pass controll back to execute() to continue or finish the transaction.
 // When transaction is finish the function execute() pass control to get() and it returns transaction result to user.
 //
-DpaTransaction2::DpaTransaction2( const DpaMessage& request,
-  RfMode mode, TimingParams params, int32_t defaultTimeout, int32_t userTimeout, SendDpaMessageFunc sender,
-  IDpaTransactionResult2::ErrorCode defaultError)
-  : m_dpaTransactionResultPtr( ant_new DpaTransactionResult2( request ) )
-  , m_state(DpaTransfer2State::kCreated)
-  , m_finish(false)
-  , m_currentCommunicationMode( mode )
-  , m_currentTimingParams( params )
-  , m_sender(sender)
-  , m_defaultError(defaultError)
-  , m_defaultTimeout( defaultTimeout )
+DpaTransaction2::Profile DpaTransaction2::makeProfile( const DpaMessage& message, int32_t defaultTimeout, int32_t userTimeout )
 {
-  TRC_FUNCTION_ENTER( PAR( mode ) << PAR( defaultTimeout ) << PAR( userTimeout ) )
-    static uint32_t transactionId = 0;
-  m_transactionId = ++transactionId;
-
-  const DpaMessage& message = m_dpaTransactionResultPtr->getRequest();
+  TRC_FUNCTION_ENTER( PAR( defaultTimeout ) << PAR( userTimeout ) )
+  Profile profile;
+  profile.defaultTimeout = defaultTimeout;
 
   int32_t requiredTimeout = userTimeout;
+  profile.defaultUserTimeout = userTimeout < 0;
+
+  // timeout class is applied just for requests to coordinator
+  profile.command = DpaCommandTable::get( message.PeripheralType(), message.PeripheralCommand() );
+  const DpaCommandTable::Entry* command = profile.command;
+  bool toCoordinator = ( message.NodeAddress() & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS;
+  profile.toCoordinator = toCoordinator;
+  DpaCommandTable::TimeoutClass timeoutClass = ( toCoordinator && command != nullptr ) ?
+    command->timeoutClass : DpaCommandTable::TimeoutClass::kDefault;
+
+  if ( command != nullptr && !command->isValidRequestLength( message.GetLength() - static_cast<int>( sizeof( TDpaIFaceHeader ) ) ) ) {
+    TRC_WARNING( "Unexpected request length: " << PAR( command->name ) << PAR( message.GetLength() ) );
+  }
 
   // check and correct timeout here before blocking:
   if ( requiredTimeout < 0 ) {
     // Discovery or SmartConnect or Authorize or FRC command ?
-    if ((message.NodeAddress() & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS && (
-          (message.DpaPacket().DpaRequestPacket_t.PNUM == PNUM_COORDINATOR && (
-            message.DpaPacket().DpaRequestPacket_t.PCMD == CMD_COORDINATOR_DISCOVERY ||
-            message.DpaPacket().DpaRequestPacket_t.PCMD == CMD_COORDINATOR_SMART_CONNECT ||
-            message.DpaPacket().DpaRequestPacket_t.PCMD == CMD_COORDINATOR_AUTHORIZE_BOND)
-          ) ||
-          (message.DpaPacket().DpaRequestPacket_t.PNUM == PNUM_FRC && (
-            message.DpaPacket().DpaRequestPacket_t.PCMD == CMD_FRC_SEND ||
-            message.DpaPacket().DpaRequestPacket_t.PCMD == CMD_FRC_SEND_SELECTIVE)
-          )
-        )
-    ) {
+    if ( timeoutClass == DpaCommandTable::TimeoutClass::kInfiniteAllowed ) {
       // Yes, set default (infinite) timeout for Discovery or SmartConnect
-      TRC_WARNING( PAR( requiredTimeout ) << " Default (infinite) timeout forced for Discovery or SmartConnect or Authorize or FRC message" );
-      m_infinitTimeout = true;
+      TRC_WARNING( PAR( requiredTimeout ) << " Default (infinite) timeout forced for " << command->name );
+      profile.infiniteTimeout = true;
     }
     // default timeout
     requiredTimeout = defaultTimeout;
   }
   else if ( requiredTimeout == INFINITE_TIMEOUT ) {
     // it is allowed just for Coordinator Discovery, SmartConnect, Authorize and FRC
-    if ((message.NodeAddress() & BROADCAST_ADDRESS ) != COORDINATOR_ADDRESS || (
-          message.DpaPacket().DpaRequestPacket_t.PNUM == PNUM_COORDINATOR &&
-          message.DpaPacket().DpaRequestPacket_t.PCMD != CMD_COORDINATOR_DISCOVERY &&
-          message.DpaPacket().DpaRequestPacket_t.PCMD != CMD_COORDINATOR_SMART_CONNECT &&
-          message.DpaPacket().DpaRequestPacket_t.PCMD != CMD_COORDINATOR_AUTHORIZE_BOND
-        ) || (
-          message.DpaPacket().DpaRequestPacket_t.PNUM == PNUM_FRC &&
-          message.DpaPacket().DpaRequestPacket_t.PCMD != CMD_FRC_SEND &&
-          message.DpaPacket().DpaRequestPacket_t.PCMD != CMD_FRC_SEND_SELECTIVE
-        )
-    ) {
+    if ( timeoutClass != DpaCommandTable::TimeoutClass::kInfiniteAllowed ) {
       // force setting minimal timing as only Discovery can have infinite timeout
       TRC_WARNING( "User: " << PAR( requiredTimeout ) << " forced to: " << PAR( defaultTimeout ) );
       requiredTimeout = defaultTimeout;
     }
     else {
-      TRC_WARNING( PAR( requiredTimeout ) << " infinite timeout allowed for Discovery or SmartConnect or Authorize or FRC message" );
+      TRC_WARNING( PAR( requiredTimeout ) << " infinite timeout allowed for " << command->name );
       requiredTimeout = defaultTimeout;
-      m_infinitTimeout = true;
+      profile.infiniteTimeout = true;
     }
   }
   else if ( requiredTimeout < defaultTimeout ) {
@@ -119,41 +100,63 @@ DpaTransaction2::DpaTransaction2( const DpaMessage& request,
   }
 
   // init expected duration - no estimation yet, so use default timeout
-  m_expectedDurationMs = m_defaultTimeout;
+  profile.expectedDurationMs = defaultTimeout;
 
   // calculate requiredTimeout for special cases
-  if ( ( message.NodeAddress() & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS )
+  if ( toCoordinator )
   {
     if ( requiredTimeout > defaultTimeout )
     {
-      m_expectedDurationMs = requiredTimeout;
+      profile.expectedDurationMs = requiredTimeout;
     }
 
-    // peripheral FRC and FRC command
-    //if ( message.DpaPacket().DpaRequestPacket_t.PNUM == PNUM_FRC &&
-    //  ( message.PeripheralCommand() == CMD_FRC_SEND || message.PeripheralCommand() == CMD_FRC_SEND_SELECTIVE ) )
-    //{
-    //  // user timeout is not applied, timeout forced to FRC 
-    //  requiredTimeout = getFrcTimeout();
-    //  m_expectedDurationMs = requiredTimeout;
-    //  TRC_WARNING( "User: " << PAR( userTimeout ) << " forced to FRC: " << PAR( requiredTimeout ) );
-    //}
-
     //bonding special timeout 
-    if ( message.DpaPacket().DpaRequestPacket_t.PNUM == PNUM_COORDINATOR &&
-      ( message.PeripheralCommand() == CMD_COORDINATOR_BOND_NODE ) )
+    if ( timeoutClass == DpaCommandTable::TimeoutClass::kBond )
     {
       // user timeout is not applied, forced to BOND_TIMEOUT_MS
       if ( userTimeout < 0 ) {
         requiredTimeout = BOND_TIMEOUT_MS;
-        m_expectedDurationMs = requiredTimeout;
+        profile.expectedDurationMs = requiredTimeout;
         TRC_INFORMATION( "Used timeout: " << PAR( BOND_TIMEOUT_MS ) );
       }
     }
   }
   
-  m_userTimeoutMs = requiredTimeout; // checked and corrected timeout
-  TRC_FUNCTION_LEAVE( "Using: " << PAR( m_userTimeoutMs ) );
+  profile.userTimeoutMs = requiredTimeout; // checked and corrected timeout
+  TRC_FUNCTION_LEAVE( "Using: " << PAR( profile.userTimeoutMs ) );
+  return profile;
+}
+
+DpaTransaction2::DpaTransaction2( const DpaMessage& request,
+  RfMode mode, std::shared_ptr<const TimingParams> params, int32_t defaultTimeout, int32_t userTimeout, SendDpaMessageFunc sender,
+  IDpaTransactionResult2::ErrorCode defaultError)
+  : DpaTransaction2( request, makeProfile( request, defaultTimeout, userTimeout ), mode, std::move( params ), std::move( sender ), defaultError )
+{
+}
+
+DpaTransaction2::DpaTransaction2( const DpaMessage& request, const Profile& profile,
+  RfMode mode, std::shared_ptr<const TimingParams> params, SendDpaMessageFunc sender,
+  IDpaTransactionResult2::ErrorCode defaultError )
+  : m_dpaTransactionResultPtr( ant_new DpaTransactionResult2( request ) )
+  , m_state(DpaTransfer2State::kCreated)
+  , m_finish(false)
+  , m_currentCommunicationMode( mode )
+  , m_currentTimingParams( std::move( params ) )
+  , m_sender( std::move( sender ) )
+  , m_defaultError(defaultError)
+  , m_defaultTimeout( profile.defaultTimeout )
+  , m_userTimeoutMs( profile.userTimeoutMs )
+  , m_expectedDurationMs( profile.expectedDurationMs )
+  , m_infinitTimeout( profile.infiniteTimeout )
+  , m_defaultUserTimeout( profile.defaultUserTimeout )
+  , m_command( profile.command )
+{
+  static uint32_t transactionId = 0;
+  m_transactionId = ++transactionId;
+  m_nodeAddress = request.NodeAddress();
+  m_peripheralType = static_cast<uint8_t>( request.PeripheralType() );
+  m_peripheralCommand = request.PeripheralCommand();
+  TRC_DEBUG( PAR( m_transactionId ) << PAR( mode ) << PAR( m_userTimeoutMs ) );
 }
 
 DpaTransaction2::~DpaTransaction2()
@@ -162,42 +165,35 @@ DpaTransaction2::~DpaTransaction2()
 
 void DpaTransaction2::abort() {
   std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  if ( m_finish ) {
+    // the caller has the result already, execute() may still hold the next request back after released response
+    return;
+  }
+  bool queued = m_state == kCreated;
   m_state = kAborted;
-  m_conditionVariable.notify_all();
+  m_notifications++;
+  m_executeCondition.notify_one();
+
+  if ( queued ) {
+    // not started yet, the result is released now and execute() skips the transaction without sending
+    if ( m_startTimerId != 0 ) {
+      m_timerWheel->cancel( m_startTimerId );
+      m_startTimerId = 0;
+    }
+    releaseResult( lck, DpaTransactionResult2::TRN_ERROR_ABORTED );
+  }
 }
 
 //-----------------------------------------------------
 std::unique_ptr<IDpaTransactionResult2> DpaTransaction2::get()
 {
-  // wait for transaction start
-  TRC_DEBUG( "wait for start: " << PAR( m_transactionId ) );
+  TRC_DEBUG( "Wait for finish: " << PAR( m_transactionId ) );
 
-  // lock this function except blocking in wait_for()
+  // lock this function except blocking in wait()
   std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
 
-  while ( m_infinitTimeout ) {
-    // wait_for() unlock lck when blocking and lock it again when get out, waiting continue if not started (predicate == false)
-    if ( !m_conditionVariable.wait_for( lck, std::chrono::milliseconds( m_userTimeoutMs ), [&] { return m_state != kCreated; } ) )
-    {
-      // out of wait timeout
-      if ( !m_infinitTimeout ) {
-        TRC_WARNING( "Transaction timeout - transaction was not started in time." );
-        m_dpaTransactionResultPtr->setErrorCode( IDpaTransactionResult2::TRN_ERROR_IFACE_BUSY );
-        // return result and move ownership 
-        return std::move( m_dpaTransactionResultPtr );
-      }
-      else {
-        TRC_WARNING( "Infinit timeout - wait forever." );
-      }
-    }
-    // out of wait notify from execute() or processReceivedMessage
-    break;
-  }
-
-  // transaction started
-  TRC_DEBUG( "Started, wait for finish: " << PAR( m_transactionId ) );
-  // wait_for() unlock lck when blocking and lock it again when get out, waiting continue if not finished (predicate == false)
-  while ( !m_conditionVariable.wait_for( lck, std::chrono::milliseconds( m_userTimeoutMs ), [&] { return m_finish; } ) );
+  // just execute() notifies m_resultCondition when the transaction finishes, the timeout is handled there
+  m_resultCondition.wait( lck, [&] { return m_finish.load(); } );
 
   // return result and move ownership 
   TRC_DEBUG( "Finished: " << PAR( m_transactionId ) << PAR( m_state ) );
@@ -218,9 +214,21 @@ void DpaTransaction2::execute(IDpaTransactionResult2::ErrorCode defaultError)
   
   m_defaultError = defaultError;
 
-  const DpaMessage& message = m_dpaTransactionResultPtr->getRequest();
+  if ( m_startTimerId != 0 ) {
+    m_timerWheel->cancel( m_startTimerId );
+    m_startTimerId = 0;
+  }
+  if ( m_state == kCreated && std::chrono::steady_clock::now() >= m_startDeadline ) {
+    m_state = kStartExpired;
+  }
+
+  if ( m_state == kAborted || m_state == kStartExpired ) {
+    // aborted or expired while queued, nothing is sent and the result is usually released already
+    m_expectedDurationMs = 0;
+  }
+  else if ( m_defaultError == IDpaTransactionResult2::TRN_OK) {
+    const DpaMessage& message = m_dpaTransactionResultPtr->getRequest();
 
-  if ( m_defaultError == IDpaTransactionResult2::TRN_OK) {
     // init transaction state
     if ( ( message.NodeAddress() & BROADCAST_ADDRESS ) == COORDINATOR_ADDRESS ) {
       m_state = kSentCoordinator;
@@ -248,8 +256,17 @@ void DpaTransaction2::execute(IDpaTransactionResult2::ErrorCode defaultError)
     m_expectedDurationMs = 0;
   }
 
-  // 1st notification to get() - we started transaction 
-  m_conditionVariable.notify_one();
+  armDeadline();
+
+  // notifications from processReceivedMessage() and abort() are counted as they can come while unlocked here
+  uint32_t notifications = m_notifications;
+
+  if ( m_progress && ( m_state == kSent || m_state == kSentCoordinator ) ) {
+    addProgress( Stage::kSent );
+    lck.unlock();
+    dispatchProgress();
+    lck.lock();
+  }
 
   int errorCode = DpaTransactionResult2::TRN_ERROR_IFACE;
   bool finish = true;
@@ -260,14 +277,19 @@ void DpaTransaction2::execute(IDpaTransactionResult2::ErrorCode defaultError)
     finish = true; // end this cycle
     expired = false;
 
-    // wait on conditon 
+    // wait on conditon for absolute deadline, it is moved just when the expected duration changes
     if ( m_expectedDurationMs > 0 ) {
-      // wait_for() unlock lck when blocking and lock it again when get out, processReceivedMessage() is able to do its job as it can lock now
-      if ( std::cv_status::timeout == m_conditionVariable.wait_for( lck, std::chrono::milliseconds( m_expectedDurationMs ) ) ) {
+      // wait unlock lck when blocking and lock it again when get out, processReceivedMessage() is able to do its job as it can lock now
+      if ( m_timerId != 0 ) {
+        // out of wait on notify from processReceivedMessage(), abort() or deadline timer
+        m_executeCondition.wait( lck, [&] { return m_notifications != notifications; } );
+        expired = m_deadlineExpired;
+      }
+      else if ( !m_executeCondition.wait_until( lck, m_deadline, [&] { return m_notifications != notifications; } ) ) {
         // out of wait on timeout
         expired = true;
       }
-      // out of wait on notify from processReceivedMessage()
+      notifications = m_notifications;
     }
 
     // evaluate state
@@ -278,12 +300,16 @@ void DpaTransaction2::execute(IDpaTransactionResult2::ErrorCode defaultError)
       case kConfirmation:
         if ( expired ) {
           if ( !m_infinitTimeout ) {
+            if ( m_state == kConfirmation ) {
+              timedOutAfterConfirmation();
+            }
             m_state = kTimeout;
             errorCode = DpaTransactionResult2::TRN_ERROR_TIMEOUT;
           }
           else {
             // reset finish we have to wait forever
             finish = false;
+            armDeadline();
           }
         }
         else {
@@ -309,6 +335,12 @@ void DpaTransaction2::execute(IDpaTransactionResult2::ErrorCode defaultError)
         else {
           // reset finish we didn't finish yet
           finish = false;
+          if ( m_releaseResultOnResponse && !m_finish ) {
+            // result is released now, just the next request is held back for the rest of expected duration
+            TRC_DEBUG( "Result released on response: " << PAR( m_transactionId ) << PAR( m_expectedDurationMs ) );
+            releaseResult( lck, DpaTransactionResult2::TRN_OK );
+            lck.lock();
+          }
         }
         break;
       case kProcessed:
@@ -326,55 +358,374 @@ void DpaTransaction2::execute(IDpaTransactionResult2::ErrorCode defaultError)
       case kDefaultError:
         errorCode = m_defaultError;
         break;
+      case kStartExpired:
+        errorCode = DpaTransactionResult2::TRN_ERROR_IFACE_BUSY;
+        break;
       default:
         errorCode = DpaTransactionResult2::TRN_ERROR_IFACE;
     }
 
   } while ( !finish );
 
+  if ( m_timerWheel && m_timerId != 0 ) {
+    m_timerWheel->cancel( m_timerId );
+    m_timerId = 0;
+  }
+
+  // result may have been released on response or at start deadline already
+  if ( !m_finish ) {
+    releaseResult( lck, errorCode );
+  }
+  else if ( m_deliveryDeferred ) {
+    m_deliveryDeferred = false;
+    bool completion = static_cast<bool>( m_completionResult );
+    lck.unlock();
+    dispatchProgress();
+    if ( completion ) {
+      runCompletion();
+    }
+  }
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::releaseResult( std::unique_lock<std::mutex>& lck, int errorCode )
+{
+  // progress and asynchronous completion are delivered out of the lock
+  std::unique_ptr<IDpaTransactionResult2> result = finishResult( errorCode );
+  lck.unlock();
+
+  dispatchProgress();
+  if ( result ) {
+    complete( std::move( result ) );
+  }
+}
+
+//-----------------------------------------------------
+std::unique_ptr<IDpaTransactionResult2> DpaTransaction2::finishResult( int errorCode )
+{
   // update error code in result
   m_dpaTransactionResultPtr->setErrorCode( errorCode );
+  m_errorCode = m_dpaTransactionResultPtr->getErrorCode();
 
   // signalize final state
   m_finish = true;
 
-  // 2st notification to get() 
-  m_conditionVariable.notify_one();
+  // notification to get()
+  m_resultCondition.notify_all();
+
+  addProgress( Stage::kFinished, errorCode );
+
+  std::unique_ptr<IDpaTransactionResult2> result;
+  if ( m_completion ) {
+    result = std::move( m_dpaTransactionResultPtr );
+  }
+  return result;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::timedOutAfterConfirmation()
+{
+  if ( !m_timeoutEstimator ) {
+    return;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - m_confirmedAt;
+  m_timeoutEstimator->recordTimeout( m_nodeAddress,
+    static_cast<int32_t>( std::chrono::duration_cast<std::chrono::milliseconds>( elapsed ).count() ) );
+  m_awaitLateResponse = true;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::recordLateResponse( const DpaMessageView& receivedMessage )
+{
+  if ( receivedMessage.MessageDirection() != DpaMessage::kResponse || receivedMessage.NodeAddress() != m_nodeAddress ||
+    receivedMessage.PeripheralType() != m_peripheralType || ( receivedMessage.PeripheralCommand() & ~0x80 ) != m_peripheralCommand ) {
+    return;
+  }
+  // the real time of the slow node, the timeout sample stays in the window as well
+  auto duration = std::chrono::steady_clock::now() - m_confirmedAt;
+  TRC_INFORMATION( "Late response recorded: " << PAR( m_transactionId ) );
+  m_timeoutEstimator->record( m_nodeAddress, static_cast<uint8_t>( m_hops ),
+    static_cast<int32_t>( std::chrono::duration_cast<std::chrono::milliseconds>( duration ).count() ) );
+  m_awaitLateResponse = false;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::setTimerWheel( std::shared_ptr<DpaTimerWheel> timerWheel )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  m_timerWheel = timerWheel;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::armDeadline()
+{
+  m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( m_expectedDurationMs );
+  m_deadlineExpired = false;
+  m_deadlineSeq++;
+
+  if ( !m_timerWheel ) {
+    return;
+  }
+  if ( m_timerId != 0 ) {
+    m_timerWheel->cancel( m_timerId );
+    m_timerId = 0;
+  }
+  if ( m_expectedDurationMs > 0 ) {
+    // the timer may expire after the transaction is released, the wheel calls it just while the transaction exists
+    uint32_t deadlineSeq = m_deadlineSeq;
+    m_timerId = m_timerWheel->schedule( m_deadline, std::weak_ptr<void>( shared_from_this() ), [this, deadlineSeq]() {
+      deadlineExpired( deadlineSeq );
+    } );
+  }
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::deadlineExpired( uint32_t deadlineSeq )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  if ( deadlineSeq == m_deadlineSeq ) {
+    m_deadlineExpired = true;
+    m_notifications++;
+    m_executeCondition.notify_one();
+  }
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::setStartDeadline( std::chrono::steady_clock::time_point deadline )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  m_startDeadline = deadline;
+  if ( m_timerWheel ) {
+    m_startTimerId = m_timerWheel->schedule( deadline, std::weak_ptr<void>( shared_from_this() ), [this]() {
+      startDeadlineExpired();
+    } );
+  }
 }
 
-  //-----------------------------------------------------
+//-----------------------------------------------------
+void DpaTransaction2::startDeadlineExpired()
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  // just queued transaction, execute() cancels the timer when it starts
+  if ( m_state != kCreated || m_finish ) {
+    return;
+  }
+  TRC_WARNING( "Transaction not started until its deadline: " << PAR( m_transactionId ) );
+  m_state = kStartExpired;
+  m_startTimerId = 0;
+
+  // the timer thread just wakes get(), progress and completion are delivered by the executor or by execute()
+  // in the queue thread, so slow observers don't hold back other timers
+  std::unique_ptr<IDpaTransactionResult2> result = finishResult( DpaTransactionResult2::TRN_ERROR_IFACE_BUSY );
+  if ( result && m_executor ) {
+    lck.unlock();
+    complete( std::move( result ) );
+    return;
+  }
+  m_completionResult = std::move( result );
+  m_deliveryDeferred = true;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::setReleaseResultOnResponse( bool release )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  m_releaseResultOnResponse = release;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::setProgress( ProgressFunc progress )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  m_progress = progress;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::setTimeoutEstimator( std::shared_ptr<DpaTimeoutEstimator> estimator, bool useEstimate )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  m_timeoutEstimator = estimator;
+  m_useEstimate = useEstimate;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::queued()
+{
+  if ( m_progress ) {
+    {
+      std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+      addProgress( Stage::kQueued );
+    }
+    dispatchProgress();
+  }
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::addProgress( Stage stage, int errorCode )
+{
+  // stages go forward only, repeated confirmations or responses are not reported
+  if ( !m_progress || ( m_progressCount > 0 && m_progressEvents[m_progressCount - 1].stage >= stage ) ) {
+    return;
+  }
+
+  ProgressEvent& event = m_progressEvents[m_progressCount++];
+  event.stage = stage;
+  event.ts = std::chrono::system_clock::now();
+  event.hops = static_cast<uint8_t>( m_hops );
+  event.timeslotLength = static_cast<uint8_t>( m_timeslotLength );
+  event.hopsResponse = static_cast<uint8_t>( m_hopsResponse );
+  event.estimatedTimeMs = m_estimatedTimeMs;
+  event.errorCode = errorCode;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::dispatchProgress()
+{
+  if ( !m_progress ) {
+    return;
+  }
+
+  // the thread holding m_progressMutex passes all recorded events, so the observer gets them in order
+  std::lock_guard<std::mutex> progressLck( m_progressMutex );
+  while ( true ) {
+    ProgressEvent event;
+    {
+      std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+      if ( m_progressDispatched >= m_progressCount ) {
+        return;
+      }
+      event = m_progressEvents[m_progressDispatched++];
+    }
+
+    try {
+      m_progress( event );
+    }
+    catch ( std::exception& e ) {
+      CATCH_EXC_TRC_WAR( std::exception, e, "Progress observer error: " << PAR( m_transactionId ) );
+    }
+  }
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::setCompletion( CompletionFunc completion, ExecutorFunc executor )
+{
+  std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
+  m_completion = completion;
+  m_executor = executor;
+}
+
+//-----------------------------------------------------
+const std::string& DpaTransaction2::getServiceId() const
+{
+  static const std::string noServiceId;
+  return m_serviceId ? *m_serviceId : noServiceId;
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::complete( std::unique_ptr<IDpaTransactionResult2> result )
+{
+  // the result waits in the transaction, so the task captures just a pointer and std::function stores it
+  // without heap allocation
+  m_completionResult = std::move( result );
+  if ( !m_executor ) {
+    runCompletion();
+    return;
+  }
+
+  // keeps the transaction alive until the executor runs the task
+  m_completionOwner = shared_from_this();
+  std::function<void()> task = [this]() {
+    std::shared_ptr<DpaTransaction2> owner = std::move( m_completionOwner );
+    // progress of result released by timer, see startDeadlineExpired()
+    dispatchProgress();
+    runCompletion();
+  };
+
+  try {
+    m_executor( task );
+  }
+  catch ( std::exception& e ) {
+    // the owner is kept, the executor might have stored the task before it threw
+    CATCH_EXC_TRC_WAR( std::exception, e, "Completion executor error: " << PAR( m_transactionId ) );
+  }
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::runCompletion()
+{
+  try {
+    m_completion( std::move( m_completionResult ) );
+  }
+  catch ( std::exception& e ) {
+    CATCH_EXC_TRC_WAR( std::exception, e, "Completion handler error: " << PAR( m_transactionId ) );
+  }
+}
+
+//-----------------------------------------------------
 void DpaTransaction2::processReceivedMessage( const DpaMessage& receivedMessage )
+{
+  processReceivedMessage( DpaMessageView( receivedMessage ) );
+}
+
+//-----------------------------------------------------
+void DpaTransaction2::processReceivedMessage( const DpaMessageView& receivedMessage )
+{
+  switch ( tryProcessReceivedMessage( receivedMessage ) ) {
+    case MatchResult::kNotResponse:
+      throw std::logic_error( "Response is expected." );
+    case MatchResult::kNodeAddressMismatch:
+      throw std::logic_error( "Different node address than in sent message." );
+    case MatchResult::kPeripheralTypeMismatch:
+      throw std::logic_error( "Different peripheral type than in sent message." );
+    case MatchResult::kPeripheralCommandMismatch:
+      throw std::logic_error( "Different peripheral command than in sent message." );
+    case MatchResult::kMatched:
+    case MatchResult::kFinished:
+    default:
+      break;
+  }
+}
+
+//-----------------------------------------------------
+DpaTransaction2::MatchResult DpaTransaction2::tryProcessReceivedMessage( const DpaMessageView& receivedMessage )
 {
   TRC_FUNCTION_ENTER( "" );
 
+  // quick check without locking, messages received after finish are common with released results
+  if ( m_finish.load() && !m_awaitLateResponse.load() ) {
+    return MatchResult::kFinished;
+  }
+
   // lock this function
   std::unique_lock<std::mutex> lck( m_conditionVariableMutex );
 
   //check transaction state
   if ( m_finish ) {
-    return; //nothing to do, just double check
+    if ( m_awaitLateResponse ) {
+      recordLateResponse( receivedMessage );
+    }
+    return MatchResult::kFinished; //nothing to do, just double check
   }
 
   DpaMessage::MessageType messageDirection = receivedMessage.MessageDirection();
 
   //check massage validity
-  // TODO verify exception handling. Do we need the exception here at all?
   // no request is expected
   if ( messageDirection != DpaMessage::kResponse && messageDirection != DpaMessage::kConfirmation ) {
-    throw std::logic_error( "Response is expected." );
+    return MatchResult::kNotResponse;
   }
   const DpaMessage& request = m_dpaTransactionResultPtr->getRequest();
   // same as sent request
   if ( receivedMessage.NodeAddress() != request.NodeAddress() ) {
-    throw std::logic_error( "Different node address than in sent message." );
+    return MatchResult::kNodeAddressMismatch;
   }
   // same as sent request
   if ( receivedMessage.PeripheralType() != request.PeripheralType() ) {
-    throw std::logic_error( "Different peripheral type than in sent message." );
+    return MatchResult::kPeripheralTypeMismatch;
   }
   // same as sent request
   if ( ( receivedMessage.PeripheralCommand() & ~0x80 ) != request.PeripheralCommand() ) {
-    throw std::logic_error( "Different peripheral command than in sent message." );
+    return MatchResult::kPeripheralCommandMismatch;
   }
 
   int32_t estimatedTimeMs = 0;
@@ -389,39 +740,76 @@ void DpaTransaction2::processReceivedMessage( const DpaMessage& receivedMessage
     }
 
     // setting timeout based on the confirmation
-    TIFaceConfirmation iFace = receivedMessage.DpaPacket().DpaResponsePacket_t.DpaMessage.IFaceConfirmation;
+    TIFaceConfirmation iFace = { 0, 0, 0 };
+    if ( receivedMessage.GetLength() >= CONFIRMATION_DATA_INDEX + static_cast<int>( sizeof( iFace ) ) ) {
+      std::copy( receivedMessage.DpaPacketData() + CONFIRMATION_DATA_INDEX,
+        receivedMessage.DpaPacketData() + CONFIRMATION_DATA_INDEX + sizeof( iFace ), reinterpret_cast<uint8_t*>( &iFace ) );
+    }
 
     // save for later use with response
     m_hops = iFace.Hops;
     m_timeslotLength = iFace.TimeSlotLength;
     m_hopsResponse = iFace.HopsResponse;
 
-    if ( m_currentCommunicationMode == RfMode::kLp ) {
-      estimatedTimeMs = EstimateLpTimeout( m_hops, m_timeslotLength, m_hopsResponse );
+    // known command has the maximal response length given, worst case is used otherwise and for diagnostic timeslot
+    int8_t expectedResponseLength = -1;
+    if ( m_command != nullptr && m_timeslotLength != 20 ) {
+      expectedResponseLength = static_cast<int8_t>( m_command->responseMax );
     }
-    else { // std
-      estimatedTimeMs = EstimateStdTimeout( m_hops, m_timeslotLength, m_hopsResponse );
+
+    m_confirmedAt = std::chrono::steady_clock::now();
+
+    // learned time of the node or hop count if there is enough history
+    bool learned = false;
+    bool lastTimedOut = false;
+    if ( m_useEstimate && m_timeoutEstimator && m_state == kConfirmation ) {
+      estimatedTimeMs = m_timeoutEstimator->estimate( receivedMessage.NodeAddress(), static_cast<uint8_t>( m_hops ), &lastTimedOut );
+      learned = estimatedTimeMs > 0;
+      TRC_DEBUG( "Learned: " << PAR( estimatedTimeMs ) << PAR( lastTimedOut ) );
+    }
+
+    // no history, estimation by the formulas, the learned time isn't used below them after the node timed out
+    if ( estimatedTimeMs <= 0 || lastTimedOut ) {
+      int32_t formulaTimeMs = 0;
+      if ( m_currentCommunicationMode == RfMode::kLp ) {
+        formulaTimeMs = EstimateLpTimeout( m_hops, m_timeslotLength, m_hopsResponse, expectedResponseLength );
+      }
+      else { // std
+        formulaTimeMs = EstimateStdTimeout( m_hops, m_timeslotLength, m_hopsResponse, expectedResponseLength );
+      }
+      estimatedTimeMs = std::max( estimatedTimeMs, formulaTimeMs );
     }
 
     if ( estimatedTimeMs > 0 ) {
       TRC_INFORMATION( "Expected duration to wait :" << PAR( m_userTimeoutMs ) << PAR( estimatedTimeMs ) );
-      if (static_cast<uint32_t>(estimatedTimeMs) >= m_userTimeoutMs ) {
+      // learned time replaces the default timeout, but not the timeout required by user
+      if ( static_cast<uint32_t>( estimatedTimeMs ) >= m_userTimeoutMs || ( learned && m_defaultUserTimeout ) ) {
         m_expectedDurationMs = estimatedTimeMs;
       }
       else {
         // user wants to wait more then estimated so keep the wish
         m_expectedDurationMs = m_userTimeoutMs;
       }
+      armDeadline();
     }
 
     TRC_DEBUG( "From confirmation: " << PAR( estimatedTimeMs ) );
+    m_estimatedTimeMs = estimatedTimeMs;
 
     m_dpaTransactionResultPtr->setConfirmation( receivedMessage );
+    addProgress( Stage::kConfirmed );
     TRC_INFORMATION( "Confirmation processed." );
   }
 
   // process response
   else {
+    int responseDataLength = receivedMessage.GetLength() - static_cast<int>( sizeof( TDpaIFaceHeader ) + 2 );
+    TErrorCodes responseCode = STATUS_NO_ERROR;
+    if ( m_command != nullptr && receivedMessage.TryResponseCode( responseCode ) && responseCode == STATUS_NO_ERROR &&
+      !m_command->isValidResponseLength( responseDataLength ) ) {
+      TRC_WARNING( "Unexpected response length: " << PAR( m_command->name ) << PAR( responseDataLength ) );
+    }
+
     // if there was a request to coordinator then after receiving response it is allowed to send another
     if ( m_state == kSentCoordinator ) {
       // done, next request gets ready 
@@ -436,17 +824,20 @@ void DpaTransaction2::processReceivedMessage( const DpaMessage& receivedMessage
         // or is it aditional refresh timeout for some reason depending on response len?
         if ( m_currentCommunicationMode == RfMode::kLp ) {
           estimatedTimeMs = EstimateLpTimeout(static_cast<uint8_t>(m_hops), static_cast<uint8_t>(m_timeslotLength), static_cast<uint8_t>(m_hopsResponse),
-            static_cast<int8_t>(receivedMessage.GetLength() - ( sizeof( TDpaIFaceHeader ) + 2 )) );
+            static_cast<int8_t>( responseDataLength ) );
         }
         else { // std
           estimatedTimeMs = EstimateStdTimeout(static_cast<uint8_t>(m_hops), static_cast<uint8_t>(m_timeslotLength), static_cast<uint8_t>(m_hopsResponse),
-            static_cast<int8_t>(receivedMessage.GetLength() - (sizeof(TDpaIFaceHeader) + 2)));
+            static_cast<int8_t>( responseDataLength ) );
         }
         TRC_DEBUG( "From response: " << PAR( estimatedTimeMs ) );
         m_expectedDurationMs = estimatedTimeMs;
         if ( m_expectedDurationMs <= 0 ) {
           m_state = kProcessed;
         }
+        else {
+          armDeadline();
+        }
         /////////////////////////////
       }
       // infinite timeout
@@ -457,13 +848,27 @@ void DpaTransaction2::processReceivedMessage( const DpaMessage& receivedMessage
     }
 
     m_dpaTransactionResultPtr->setResponse( receivedMessage );
+    addProgress( Stage::kResponded );
+
+    // learn confirmation to response time of the node
+    if ( m_timeoutEstimator && m_dpaTransactionResultPtr->isConfirmed() &&
+      ( receivedMessage.NodeAddress() & BROADCAST_ADDRESS ) != BROADCAST_ADDRESS ) {
+      auto duration = m_dpaTransactionResultPtr->getResponseTs() - m_dpaTransactionResultPtr->getConfirmationTs();
+      m_timeoutEstimator->record( receivedMessage.NodeAddress(), static_cast<uint8_t>( m_hops ),
+        static_cast<int32_t>( std::chrono::duration_cast<std::chrono::milliseconds>( duration ).count() ) );
+    }
     TRC_INFORMATION( "Response processed." );
   }
 
-  // notification to execute() and get()
-  m_conditionVariable.notify_all();
+  // notification to execute()
+  m_notifications++;
+  m_executeCondition.notify_one();
+
+  lck.unlock();
+  dispatchProgress();
 
   TRC_FUNCTION_LEAVE( "" );
+  return MatchResult::kMatched;
 }
 
   // TODO it is not necessary pass the values as they are stored in members
@@ -487,7 +892,7 @@ int32_t DpaTransaction2::EstimateStdTimeout( uint8_t hopsRequest, uint8_t timesl
   // correction of the estimation from response 
   else {
     TRC_DEBUG( "PData length of the received response: " << PAR( (int)responseDataLength ) );
-    if ( m_currentTimingParams.osVersion == "4.03D" ) {
+    if ( m_currentTimingParams->osVersion == "4.03D" ) {
       // OS 4.03D
       if( responseDataLength < 17)
         responseTimeSlotLengthMs = 40;
@@ -535,7 +940,7 @@ int32_t DpaTransaction2::EstimateLpTimeout( uint8_t hopsRequest, uint8_t timeslo
   // correction of the estimation from response 
   else {
     TRC_DEBUG( "PData length of the received response: " << PAR( (int)responseDataLength ) );
-    if ( m_currentTimingParams.osVersion == "4.03D" ) {
+    if ( m_currentTimingParams->osVersion == "4.03D" ) {
       // OS 4.03D
       if ( responseDataLength < 17 )
         responseTimeSlotLengthMs = 80;
@@ -571,7 +976,7 @@ int32_t DpaTransaction2::getFrcTimeout()
   uint32_t FrcResponseTime;
 
   // set FRC response time
-  switch ( m_currentTimingParams.frcResponseTime ) {
+  switch ( m_currentTimingParams->frcResponseTime ) {
     case IDpaTransaction2::FrcResponseTime::k360Ms:
       FrcResponseTime = 360;
       break;
@@ -608,10 +1013,10 @@ int32_t DpaTransaction2::getFrcTimeout()
 
   if ( m_currentCommunicationMode == RfMode::kStd )
     // STD mode Advanced FRC
-    timeout = m_currentTimingParams.bondedNodes * 30 + ( m_currentTimingParams.discoveredNodes + 2 ) * 110 + FrcResponseTime + 220;
+    timeout = m_currentTimingParams->bondedNodes * 30 + ( m_currentTimingParams->discoveredNodes + 2 ) * 110 + FrcResponseTime + 220;
   else
     // LP mode Advanced FRC
-    timeout = m_currentTimingParams.bondedNodes * 30 + ( m_currentTimingParams.discoveredNodes + 2 ) * 160 + FrcResponseTime + 260;
+    timeout = m_currentTimingParams->bondedNodes * 30 + ( m_currentTimingParams->discoveredNodes + 2 ) * 160 + FrcResponseTime + 260;
 
   return timeout;
 }
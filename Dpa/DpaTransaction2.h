@@ -20,26 +20,138 @@
 #include "IDpaTransaction2.h"
 #include "DpaTransactionResult2.h"
 #include "DpaMessage.h"
+#include "DpaMessageView.h"
+#include "DpaCommandTable.h"
+#include "DpaTimeoutEstimator.h"
+#include "DpaTimerWheel.h"
+#include <atomic>
 #include <condition_variable>
 #include <memory>
+#include <string>
 
-class DpaTransaction2 : public IDpaTransaction2
+class DpaTransaction2 : public IDpaTransaction2, public std::enable_shared_from_this<DpaTransaction2>
 {
 public:
   /// type of functor to send the request message towards the coordinator
   typedef std::function<void( const DpaMessage& dpaMessage )> SendDpaMessageFunc;
+
+  /// type of functor called with the result when the transaction finishes
+  typedef std::function<void( std::unique_ptr<IDpaTransactionResult2> result )> CompletionFunc;
+  /// type of functor running the completion functor
+  typedef std::function<void( std::function<void()> task )> ExecutorFunc;
+
+  /// result of matching of received message to the transaction
+  enum class MatchResult {
+    /// confirmation or response of the transaction processed
+    kMatched,
+    /// transaction already finished, message ignored
+    kFinished,
+    /// message is neither confirmation nor response
+    kNotResponse,
+    /// different node address than in sent request
+    kNodeAddressMismatch,
+    /// different peripheral type than in sent request
+    kPeripheralTypeMismatch,
+    /// different peripheral command than in sent request
+    kPeripheralCommandMismatch
+  };
+
+  /// timeout classification of a request, it depends just on the command, coordinator addressing and timeouts
+  /// so it can be computed once for repeated requests of the same shape
+  struct Profile {
+    /// metadata of the request command, nullptr for unknown command
+    const DpaCommandTable::Entry* command = nullptr;
+    /// default timeout the profile was computed with
+    int32_t defaultTimeout = DEFAULT_TIMEOUT;
+    /// checked and corrected user timeout
+    uint32_t userTimeoutMs = DEFAULT_TIMEOUT;
+    /// initial expected duration
+    uint32_t expectedDurationMs = DEFAULT_TIMEOUT;
+    /// request addressed to coordinator
+    bool toCoordinator = false;
+    bool infiniteTimeout = false;
+    /// user didn't require timeout
+    bool defaultUserTimeout = true;
+  };
+
+  /// \brief Classify request and check its timeout
+  /// \param [in] request DPA request
+  /// \param [in] defaultTimeout default timeout of handler
+  /// \param [in] userTimeout 0 > timeout - use default, 0 == timeout - use infinit, 0 < timeout - user value
+  /// \return timeout profile of the request
+  static Profile makeProfile( const DpaMessage& request, int32_t defaultTimeout, int32_t userTimeout );
+
   DpaTransaction2() = delete;
   DpaTransaction2( const DpaMessage& request,
-    RfMode mode, TimingParams params, int32_t defaultTimeout, int32_t userTimeout, SendDpaMessageFunc sender,
+    RfMode mode, std::shared_ptr<const TimingParams> params, int32_t defaultTimeout, int32_t userTimeout, SendDpaMessageFunc sender,
     IDpaTransactionResult2::ErrorCode defaultError);
+  /// \brief Construct transaction with already computed profile
+  /// \details
+  /// The profile has to be made by makeProfile() for a request with the same command and length
+  /// and with the same coordinator addressing.
+  DpaTransaction2( const DpaMessage& request, const Profile& profile,
+    RfMode mode, std::shared_ptr<const TimingParams> params, SendDpaMessageFunc sender,
+    IDpaTransactionResult2::ErrorCode defaultError );
   virtual ~DpaTransaction2();
   void abort() override;
   std::unique_ptr<IDpaTransactionResult2> get();
   void execute();
   void execute(IDpaTransactionResult2::ErrorCode defaultError);
+  /// \brief Set completion of asynchronous transaction, it has to be set before execute()
+  /// \param [in] completion called with the result when the transaction finishes, get() returns nullptr then
+  /// \param [in] executor runs the completion, nullptr runs it inline in the thread finishing the transaction,
+  /// with executor the transaction has to be owned by std::shared_ptr
+  void setCompletion( CompletionFunc completion, ExecutorFunc executor );
+  /// \brief Set progress observer, it has to be set before the transaction is queued
+  /// \param [in] progress called with the stages of the transaction in order, each stage at most once
+  void setProgress( ProgressFunc progress );
+  /// \brief Set estimator learning confirmation to response time, it has to be set before the transaction is queued
+  /// \param [in] estimator records the time of this transaction
+  /// \param [in] useEstimate the learned time is used instead of the formulas if available
+  void setTimeoutEstimator( std::shared_ptr<DpaTimeoutEstimator> estimator, bool useEstimate );
+  /// \brief Set timer wheel driving the deadlines of execute(), it has to be set before the transaction is queued
+  /// \details
+  /// The transaction has to be owned by std::shared_ptr then. Without timer wheel execute() waits
+  /// for the deadlines itself.
+  void setTimerWheel( std::shared_ptr<DpaTimerWheel> timerWheel );
+  /// \brief Release result to get() or completion as soon as a node response arrives
+  /// \details
+  /// execute() still waits for the rest of the expected duration after the response, so the next request
+  /// is not sent before the network finishes. It has to be set before the transaction is queued.
+  void setReleaseResultOnResponse( bool release );
+  /// \brief Set absolute time until the request has to be sent, it has to be set before the transaction is queued
+  /// \details
+  /// The transaction not started until the deadline finishes with TRN_ERROR_IFACE_BUSY and the request is not sent.
+  /// With timer wheel get() gets the result at the deadline even while the transaction is still queued, the completion
+  /// is passed to the executor then. Without executor the completion and the progress are delivered by execute().
+  void setStartDeadline( std::chrono::steady_clock::time_point deadline );
+  /// \brief Set predicted time the transaction occupies the interface, used by handler admission control
+  void setPredictedDurationMs( int32_t predictedDurationMs ) { m_predictedDurationMs = predictedDurationMs; }
+  int32_t getPredictedDurationMs() const { return m_predictedDurationMs; }
+  /// \brief Set identification of service issuing the transaction, it has to be set before the transaction is queued
+  /// \details The string is shared, so handler copies just the pointer of the service id it keeps
+  void setServiceId( std::shared_ptr<const std::string> serviceId ) { m_serviceId = serviceId; }
+  const std::string& getServiceId() const;
+  /// \brief Mark transaction queued as a member of batch, it is not counted to the queue length limit
+  void setBatched( bool batched ) { m_batched = batched; }
+  bool isBatched() const { return m_batched; }
+  /// \return node address of the request
+  uint16_t getNodeAddress() const { return m_nodeAddress; }
+  /// \return error code of the result, valid after execute() returned
+  int getErrorCode() const { return m_errorCode; }
+  /// \brief Report the transaction as queued, called by handler before it is pushed to the queue
+  void queued();
   void processReceivedMessage( const DpaMessage& receivedMessage );
+  void processReceivedMessage( const DpaMessageView& receivedMessage );
+  /// \brief Process received message without throwing
+  /// \param [in] receivedMessage confirmation or response
+  /// \return match result, the message is processed only if kMatched
+  MatchResult tryProcessReceivedMessage( const DpaMessageView& receivedMessage );
 
 private:
+  /// index of confirmation data in received message (foursome + HWPID + ResponseCode + DpaValue)
+  static const int CONFIRMATION_DATA_INDEX = sizeof( TDpaIFaceHeader ) + 2;
+
   //// Values that represent transaction state.
   enum DpaTransfer2State
   {
@@ -64,7 +176,9 @@ private:
     /// error state during sending via iqrf interface.
     kInterfaceError,
     /// error state enforced at the beginning of the transaction
-    kDefaultError
+    kDefaultError,
+    /// transaction not started until its start deadline
+    kStartExpired
   };
 
   /// Result object tobe returned when the transaction finishes
@@ -72,34 +186,96 @@ private:
 
   /// transaction state
   DpaTransfer2State m_state = DpaTransfer2State::kCreated;
-  /// signalize final state
-  bool m_finish = false;
+  /// signalize final state, set under m_conditionVariableMutex, read without lock for quick checks
+  std::atomic<bool> m_finish { false };
 
   /// actual communication mode
   RfMode m_currentCommunicationMode;
 
-  /// actual timing params
-  TimingParams m_currentTimingParams;
+  /// actual timing params, shared by transactions created with the same params
+  std::shared_ptr<const TimingParams> m_currentTimingParams;
 
   /// functor to send the request message towards the coordinator
   SendDpaMessageFunc m_sender;
 
+  /// completion of asynchronous transaction and its executor
+  CompletionFunc m_completion;
+  ExecutorFunc m_executor;
+  /// result waiting for the completion and the owner keeping the transaction alive until the executor runs it
+  std::unique_ptr<IDpaTransactionResult2> m_completionResult;
+  std::shared_ptr<DpaTransaction2> m_completionOwner;
+  /// result released at start deadline, execute() delivers its progress and completion
+  bool m_deliveryDeferred = false;
+
+  /// progress observer and the events to be passed to it
+  ProgressFunc m_progress;
+  ProgressEvent m_progressEvents[static_cast<int>( Stage::kFinished ) + 1];
+  /// number of events recorded, guarded by m_conditionVariableMutex
+  int m_progressCount = 0;
+  /// number of events passed to observer, guarded by both m_progressMutex and m_conditionVariableMutex
+  int m_progressDispatched = 0;
+  /// serializes the observer calls, locked before m_conditionVariableMutex
+  std::mutex m_progressMutex;
+
+  /// event count of m_executeCondition, execute() waits for its change so notifications are not lost
+  /// while execute() is unlocked and spurious wakeups are ignored
+  uint32_t m_notifications = 0;
+
   IDpaTransactionResult2::ErrorCode m_defaultError = IDpaTransactionResult2::TRN_OK;
   uint32_t m_defaultTimeout = DEFAULT_TIMEOUT; //set form configuration
   uint32_t m_userTimeoutMs = DEFAULT_TIMEOUT; //required by user
   uint32_t m_expectedDurationMs = DEFAULT_TIMEOUT;
   bool m_infinitTimeout = false;
+  /// result is passed to get() or completion on node response, see setReleaseResultOnResponse()
+  bool m_releaseResultOnResponse = false;
+  /// user didn't require timeout
+  bool m_defaultUserTimeout = true;
+
+  /// absolute deadline of the expected duration and its timer
+  std::chrono::steady_clock::time_point m_deadline;
+  std::shared_ptr<DpaTimerWheel> m_timerWheel;
+  DpaTimerWheel::TimerId m_timerId = 0;
+  /// incremented by armDeadline(), timers of previous deadlines are ignored
+  uint32_t m_deadlineSeq = 0;
+  bool m_deadlineExpired = false;
+
+  /// absolute time until the request has to be sent and its timer
+  std::chrono::steady_clock::time_point m_startDeadline = std::chrono::steady_clock::time_point::max();
+  DpaTimerWheel::TimerId m_startTimerId = 0;
+  int32_t m_predictedDurationMs = 0;
+
+  /// service issuing the transaction, see setServiceId()
+  std::shared_ptr<const std::string> m_serviceId;
+  uint16_t m_nodeAddress = 0;
+  bool m_batched = false;
+  int m_errorCode = IDpaTransactionResult2::TRN_OK;
+
+  /// learned confirmation to response times
+  std::shared_ptr<DpaTimeoutEstimator> m_timeoutEstimator;
+  bool m_useEstimate = false;
+  /// time of confirmation for the estimator
+  std::chrono::steady_clock::time_point m_confirmedAt;
+  /// timed out after confirmation, a late response is still recorded to the estimator
+  std::atomic<bool> m_awaitLateResponse { false };
+  uint8_t m_peripheralType = 0;
+  uint8_t m_peripheralCommand = 0;
+
+  /// metadata of the request command, nullptr for unknown command
+  const DpaCommandTable::Entry* m_command = nullptr;
 
   /// iqrf structure info to estimate transaction processing time
   int8_t m_hops = 0;
   int8_t m_timeslotLength = 0;
   int8_t m_hopsResponse = 0;
+  int32_t m_estimatedTimeMs = 0;
 
   TimingParams m_FRC_TimingParams;
 
-  /// condition used to wait for confirmation and response messages from coordinator
-  std::condition_variable m_conditionVariable;
-  /// mutex to protect shared variables controlled by condition variable
+  /// condition used by execute() to wait for confirmation and response messages from coordinator or abort()
+  std::condition_variable m_executeCondition;
+  /// condition used by get() to wait for the result
+  std::condition_variable m_resultCondition;
+  /// mutex to protect shared variables controlled by the conditions
   std::mutex m_conditionVariableMutex;
 
   /// internal transaction ID
@@ -111,4 +287,25 @@ private:
   int32_t EstimateStdTimeout( uint8_t hopsRequest, uint8_t timeslotReq, uint8_t hopsResponse, int8_t responseDataLength = -1 );
   int32_t EstimateLpTimeout( uint8_t hopsRequest, uint8_t timeslotReq, uint8_t hopsResponse, int8_t responseDataLength = -1 );
   int32_t getFrcTimeout();
+  // set deadline to m_expectedDurationMs from now, called with m_conditionVariableMutex locked
+  void armDeadline();
+  // called by timer wheel when the deadline expires
+  void deadlineExpired( uint32_t deadlineSeq );
+  // called by timer wheel when the start deadline expires
+  void startDeadlineExpired();
+  // set result error code, finish and pass the result to get() or completion, lck is unlocked on return
+  void releaseResult( std::unique_lock<std::mutex>& lck, int errorCode );
+  // set result error code and finish, returns the result for completion if any, called with m_conditionVariableMutex locked
+  std::unique_ptr<IDpaTransactionResult2> finishResult( int errorCode );
+  // record timeout to estimator, called with m_conditionVariableMutex locked
+  void timedOutAfterConfirmation();
+  // record response received after timeout to estimator, called with m_conditionVariableMutex locked
+  void recordLateResponse( const DpaMessageView& receivedMessage );
+  void complete( std::unique_ptr<IDpaTransactionResult2> result );
+  // pass m_completionResult to the completion
+  void runCompletion();
+  // record progress event, called with m_conditionVariableMutex locked
+  void addProgress( Stage stage, int errorCode = IDpaTransactionResult2::TRN_OK );
+  // pass recorded events to observer, called with m_conditionVariableMutex unlocked
+  void dispatchProgress();
 };
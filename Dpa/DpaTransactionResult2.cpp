@@ -109,10 +109,47 @@ void DpaTransactionResult2::setResponse( const DpaMessage& response )
   }
 }
 
+void DpaTransactionResult2::setConfirmation( const DpaMessageView& confirmation )
+{
+  m_confirmation_ts = std::chrono::system_clock::now();
+  confirmation.CopyTo( m_confirmation );
+  m_isConfirmed = true;
+}
+
+void DpaTransactionResult2::setResponse( const DpaMessageView& response )
+{
+  m_response_ts = std::chrono::system_clock::now();
+  response.CopyTo( m_response );
+  if ( 0 < response.GetLength() ) {
+    m_responseCode = response.GetLength() > RESPONSE_CODE_INDEX ? response.DpaPacketData()[RESPONSE_CODE_INDEX] : 0;
+    m_isResponded = true;
+  }
+  else {
+    m_isResponded = false;
+  }
+}
+
 void DpaTransactionResult2::setErrorCode( int errorCode )
 {
   if ( errorCode == TRN_OK && m_responseCode != TRN_OK ) {
     errorCode = m_responseCode;
   }
   m_errorCode = errorCode;
-}
\ No newline at end of file
+}
+
+void* DpaTransactionResult2::operator new( size_t size )
+{
+  if ( size != sizeof( DpaTransactionResult2 ) ) {
+    return ::operator new( size );
+  }
+  return DpaPool<sizeof( DpaTransactionResult2 )>::allocate();
+}
+
+void DpaTransactionResult2::operator delete( void* p, size_t size )
+{
+  if ( size != sizeof( DpaTransactionResult2 ) ) {
+    ::operator delete( p );
+    return;
+  }
+  DpaPool<sizeof( DpaTransactionResult2 )>::deallocate( p );
+}
@@ -18,11 +18,15 @@
 #pragma once
 
 #include "IDpaTransactionResult2.h"
+#include "DpaMessageView.h"
+#include "DpaPool.h"
 #include <string>
 
 class DpaTransactionResult2 : public IDpaTransactionResult2
 {
 private:
+  /// index of response code in received message
+  static const int RESPONSE_CODE_INDEX = 6;
   /// original request creating the transaction
   DpaMessage m_request;
   /// received  confirmation
@@ -60,5 +64,16 @@ public:
   bool isResponded() const override;
   void setConfirmation( const DpaMessage& confirmation );
   void setResponse( const DpaMessage& response );
+  void setConfirmation( const DpaMessageView& confirmation );
+  void setResponse( const DpaMessageView& response );
   void setErrorCode( int errorCode );
+
+  /// results are recycled by DpaPool, the user releases them via IDpaTransactionResult2 virtual destructor
+  static void* operator new( size_t size );
+  static void operator delete( void* p, size_t size );
+#if defined WIN32 && defined _DEBUG
+  // placement form used by ant_new
+  static void* operator new( size_t size, int, const char*, int ) { return operator new( size ); }
+  static void operator delete( void* p, int, const char*, int ) { operator delete( p, sizeof( DpaTransactionResult2 ) ); }
+#endif
 };
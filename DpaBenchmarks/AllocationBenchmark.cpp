@@ -0,0 +1,175 @@
+/**
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Counts heap allocations per transaction of DpaHandler2 with loopback channel answering coordinator requests,
+// global operator new is replaced by a counting one, allocations of all threads are counted.
+// Each case is warmed up first, so pools and reused buffers reach their peak, then the steady state
+// has to make no allocation, the benchmark fails otherwise. The tracer is not started, tracing with
+// level Information or Debug formats messages on heap.
+// usage: AllocationBenchmark [transactions]
+
+#include "LoopbackChannel.h"
+#include "DpaHandler2.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+using namespace std;
+
+namespace {
+  atomic<uint64_t> allocations( 0 );
+}
+
+void* operator new( size_t size )
+{
+  allocations.fetch_add( 1, memory_order_relaxed );
+  void* p = malloc( size > 0 ? size : 1 );
+  if ( p == nullptr ) {
+    throw bad_alloc();
+  }
+  return p;
+}
+
+void operator delete( void* p ) noexcept
+{
+  free( p );
+}
+
+namespace {
+  // waits for completions of asynchronous transactions
+  class Completions
+  {
+  public:
+    void completed( unique_ptr<IDpaTransactionResult2> result )
+    {
+      lock_guard<mutex> lck( m_mutex );
+      if ( result->getErrorCode() != 0 ) {
+        m_errors++;
+      }
+      m_count++;
+      m_condition.notify_all();
+    }
+
+    void wait( int count )
+    {
+      unique_lock<mutex> lck( m_mutex );
+      m_condition.wait( lck, [&] { return m_count >= count; } );
+    }
+
+    int errors()
+    {
+      lock_guard<mutex> lck( m_mutex );
+      return m_errors;
+    }
+
+  private:
+    mutex m_mutex;
+    condition_variable m_condition;
+    int m_count = 0;
+    int m_errors = 0;
+  };
+
+  // prints allocations per transaction, returns false if the steady state allocated
+  bool report( const char* name, uint64_t count, int transactions, int errors )
+  {
+    cout << name << " " << static_cast<double>( count ) / transactions << " allocations per transaction, errors: "
+      << errors << ( count > 0 ? " FAILED" : "" ) << endl;
+    return count == 0;
+  }
+
+  int executeSync( IDpaHandler2& handler, const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+    int transactions )
+  {
+    int errors = 0;
+    for ( int i = 0; i < transactions; i++ ) {
+      if ( handler.executeDpaTransaction( request, options )->get()->getErrorCode() != 0 ) {
+        errors++;
+      }
+    }
+    return errors;
+  }
+
+  int executeAsync( IDpaHandler2& handler, const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+    int transactions )
+  {
+    Completions completions;
+    for ( int i = 0; i < transactions; i++ ) {
+      handler.executeDpaTransactionAsync( request, options, [&completions]( unique_ptr<IDpaTransactionResult2> result ) {
+        completions.completed( move( result ) );
+      } );
+      completions.wait( i + 1 );
+    }
+    return completions.errors();
+  }
+
+  typedef int ( *ExecuteFunc )( IDpaHandler2& handler, const DpaMessage& request, const IDpaHandler2::TransactionOptions& options,
+    int transactions );
+
+  bool run( const char* name, ExecuteFunc execute, IDpaHandler2& handler, const DpaMessage& request,
+    const IDpaHandler2::TransactionOptions& options, int transactions )
+  {
+    execute( handler, request, options, transactions / 2 + 1 );
+    uint64_t count = allocations;
+    int errors = execute( handler, request, options, transactions );
+    return report( name, allocations - count, transactions, errors );
+  }
+}
+
+int main( int argc, char** argv )
+{
+  int transactions = argc > 1 ? atoi( argv[1] ) : 20000;
+
+  // coordinator address info
+  const unsigned char addrInfo[] = { 0x00, 0x00, PNUM_COORDINATOR, CMD_COORDINATOR_ADDR_INFO, 0xff, 0xff };
+  DpaMessage request( addrInfo, static_cast<uint8_t>( sizeof( addrInfo ) ) );
+  // coordinator RAM write, the frame doesn't fit std::string local buffer
+  const unsigned char ramWrite[] = { 0x00, 0x00, PNUM_RAM, CMD_RAM_WRITE, 0xff, 0xff, 0x00,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+  DpaMessage longRequest( ramWrite, static_cast<uint8_t>( sizeof( ramWrite ) ) );
+
+  LoopbackChannel channel;
+  DpaHandler2 handler( &channel );
+
+  IDpaHandler2::TransactionOptions options;
+  IDpaHandler2::TransactionOptions serviceOptions;
+  serviceOptions.serviceId = "iqrfgw::JsonDpaApiIqrfStandard";
+  IDpaHandler2::TransactionOptions retryOptions;
+  retryOptions.retry.maxAttempts = 3;
+  retryOptions.retry.backoffMs = 1;
+
+  bool ok = true;
+  cout << "Coordinator transactions over loopback channel: " << transactions << endl;
+  ok = run( "sync:                  ", executeSync, handler, request, options, transactions ) && ok;
+  ok = run( "sync long request:     ", executeSync, handler, longRequest, options, transactions ) && ok;
+  ok = run( "async inline:          ", executeAsync, handler, request, options, transactions ) && ok;
+  ok = run( "async with service id: ", executeAsync, handler, request, serviceOptions, transactions ) && ok;
+  ok = run( "async with retry:      ", executeAsync, handler, request, retryOptions, transactions ) && ok;
+
+  // each transaction but the first one times out once, waits for backoff and succeeds
+  channel.setDropEvery( 2 );
+  ok = run( "async retried:         ", executeAsync, handler, request, retryOptions, 20 ) && ok;
+  channel.setDropEvery( 0 );
+
+  handler.setCompletionExecutor( []( function<void()> task ) {
+    task();
+  } );
+  ok = run( "async with executor:   ", executeAsync, handler, request, options, transactions ) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/**
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares DpaEndian loads and DpaFields accessors with direct access to packed fields
+// and with byte assembly, the values are read at odd (unaligned) addresses
+// usage: EndianBenchmark [iterations]
+
+#include "DpaFields.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+  const int RECORDS = 1024;
+
+  // packed records at odd offsets of a byte buffer as in received DPA messages
+  struct Records
+  {
+    vector<uint8_t> buffer;
+    const uint8_t* at( int i ) const { return buffer.data() + 1 + i * sizeof( TPerOSRead_Response ); }
+  };
+
+  template <typename Func>
+  double run( const char* name, int iterations, Func func )
+  {
+    uint32_t sum = 0;
+    auto start = chrono::steady_clock::now();
+    for ( int n = 0; n < iterations; n++ ) {
+      for ( int i = 0; i < RECORDS; i++ ) {
+        sum += func( i );
+      }
+    }
+    double ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+    cout << name << " " << ms << " ms (sum " << sum << ")" << endl;
+    return ms;
+  }
+}
+
+int main( int argc, char** argv )
+{
+  int iterations = argc > 1 ? atoi( argv[1] ) : 100000;
+
+  Records records;
+  records.buffer.resize( 1 + RECORDS * sizeof( TPerOSRead_Response ) );
+  srand( 1 );
+  for ( auto& byte : records.buffer ) {
+    byte = static_cast<uint8_t>( rand() );
+  }
+
+  cout << "OsBuild and HWPID of " << RECORDS << " packed records, " << iterations << " iterations" << endl;
+
+  run( "byte assembly:      ", iterations, [&]( int i ) {
+    const uint8_t* p = records.at( i );
+    const size_t osBuild = offsetof( TPerOSRead_Response, OsBuild );
+    const size_t hwpid = offsetof( TPerOSRead_Response, HWPID );
+    return static_cast<uint32_t>( ( p[osBuild] | ( p[osBuild + 1] << 8 ) ) + ( p[hwpid] | ( p[hwpid + 1] << 8 ) ) );
+  } );
+
+  run( "packed field:       ", iterations, [&]( int i ) {
+    const TPerOSRead_Response* r = reinterpret_cast<const TPerOSRead_Response*>( records.at( i ) );
+    return static_cast<uint32_t>( r->OsBuild + r->HWPID );
+  } );
+
+  run( "DpaEndian::loadLe16:", iterations, [&]( int i ) {
+    const uint8_t* p = records.at( i );
+    return static_cast<uint32_t>( DpaEndian::loadLe16( p + offsetof( TPerOSRead_Response, OsBuild ) ) +
+      DpaEndian::loadLe16( p + offsetof( TPerOSRead_Response, HWPID ) ) );
+  } );
+
+  run( "DpaFields:          ", iterations, [&]( int i ) {
+    const TPerOSRead_Response& r = *reinterpret_cast<const TPerOSRead_Response*>( records.at( i ) );
+    return static_cast<uint32_t>( DpaFields::getOsBuild( r ) + DpaFields::getHWPID( r ) );
+  } );
+
+  return 0;
+}
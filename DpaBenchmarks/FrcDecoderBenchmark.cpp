@@ -0,0 +1,81 @@
+/**
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares SIMD and scalar unpacking of 2 bits FRC data
+// usage: FrcDecoderBenchmark [iterations]
+
+#include "DpaFrcDecoder.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+  typedef int( *Unpack2BitFunc )( const uint8_t*, int, uint8_t( & )[DpaFrcDecoder::MAX_NODES] );
+
+  const int DATA_SETS = 64;
+
+  // returns duration in ms, the checksum keeps the results alive
+  double run( Unpack2BitFunc unpack, const uint8_t( &data )[DATA_SETS][DpaFrcDecoder::FRC_DATA_LENGTH], int iterations,
+    unsigned& checksum )
+  {
+    uint8_t values[DpaFrcDecoder::MAX_NODES];
+    auto start = chrono::steady_clock::now();
+    for ( int i = 0; i < iterations; i++ ) {
+      checksum += unpack( data[i % DATA_SETS], DpaFrcDecoder::FRC_DATA_LENGTH, values );
+      checksum += values[i % DpaFrcDecoder::MAX_NODES];
+    }
+    return chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+  }
+}
+
+int main( int argc, char** argv )
+{
+  int iterations = argc > 1 ? atoi( argv[1] ) : 1000000;
+
+  uint8_t data[DATA_SETS][DpaFrcDecoder::FRC_DATA_LENGTH];
+  srand( 1 );
+  for ( auto& set : data ) {
+    for ( auto& byte : set ) {
+      byte = static_cast<uint8_t>( rand() );
+    }
+  }
+
+  // both implementations have to give the same values
+  for ( const auto& set : data ) {
+    uint8_t simd[DpaFrcDecoder::MAX_NODES];
+    uint8_t scalar[DpaFrcDecoder::MAX_NODES];
+    DpaFrcDecoder::unpack2Bit( set, DpaFrcDecoder::FRC_DATA_LENGTH, simd );
+    DpaFrcDecoder::unpack2BitScalar( set, DpaFrcDecoder::FRC_DATA_LENGTH, scalar );
+    if ( memcmp( simd, scalar, sizeof( simd ) ) != 0 ) {
+      cout << "unpack2Bit() differs from unpack2BitScalar()" << endl;
+      return 1;
+    }
+  }
+
+  unsigned checksum = 0;
+  double kernelMs = run( &DpaFrcDecoder::unpack2Bit, data, iterations, checksum );
+  double scalarMs = run( &DpaFrcDecoder::unpack2BitScalar, data, iterations, checksum );
+
+  cout << "2 bits FRC unpack, " << iterations << " iterations" << endl;
+  cout << "unpack2Bit:       " << kernelMs << " ms" << endl;
+  cout << "unpack2BitScalar: " << scalarMs << " ms" << endl;
+  cout << "checksum: " << checksum << endl;
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares DpaJson writer with the same JSON formatted by std::ostringstream,
+// it measures also writing of whole transaction results and parsing of messages
+// usage: JsonBenchmark [iterations]
+
+#include "DpaJson.h"
+#include "DpaRequest.h"
+#include "DpaTransactionResult2.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+  // the same format as DpaJson::writeMessage()
+  string writeMessageStream( const DpaMessage& message )
+  {
+    const uint8_t* data = message.DpaPacketData();
+    int length = message.GetLength();
+    int dataIndex = sizeof( TDpaIFaceHeader );
+
+    ostringstream os;
+    os << "{\"nadr\":" << message.NodeAddress() << ",\"pnum\":" << static_cast<int>( message.PeripheralType() )
+      << ",\"pcmd\":" << static_cast<int>( message.PeripheralCommand() ) << ",\"hwpid\":" << message.Hwpid();
+    if ( message.MessageDirection() != DpaMessage::kRequest ) {
+      os << ",\"rcode\":" << static_cast<int>( data[dataIndex] ) << ",\"dpaval\":" << static_cast<int>( data[dataIndex + 1] );
+      dataIndex += 2;
+    }
+    os << ",\"pdata\":\"" << hex << setfill( '0' );
+    for ( int i = dataIndex; i < length; i++ ) {
+      os << setw( 2 ) << static_cast<int>( data[i] );
+    }
+    os << "\"}";
+    return os.str();
+  }
+
+  template <typename Func>
+  void run( const char* name, int iterations, Func func )
+  {
+    size_t total = 0;
+    auto start = chrono::steady_clock::now();
+    for ( int i = 0; i < iterations; i++ ) {
+      total += func();
+    }
+    double ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+    cout << name << " " << ms << " ms, " << static_cast<long long>( iterations / ms * 1000 ) << " per second ("
+      << total << " chars)" << endl;
+  }
+}
+
+int main( int argc, char** argv )
+{
+  int iterations = argc > 1 ? atoi( argv[1] ) : 1000000;
+
+  // OS read of node 1 and its response
+  DpaRequest<PNUM_OS, CMD_OS_READ> osRead;
+  DpaMessage request = osRead.Build( 1 );
+  uint8_t responseData[8 + sizeof( TPerOSRead_Response )] = { 0x01, 0x00, PNUM_OS, CMD_OS_READ | 0x80, 0xff, 0xff, 0x00, 0x40 };
+  srand( 1 );
+  for ( size_t i = 8; i < sizeof( responseData ); i++ ) {
+    responseData[i] = static_cast<uint8_t>( rand() );
+  }
+  DpaMessage response( responseData, static_cast<uint8_t>( sizeof( responseData ) ) );
+
+  DpaTransactionResult2 result( request );
+  result.setResponse( response );
+  result.setErrorCode( IDpaTransactionResult2::TRN_OK );
+
+  char buffer[2048];
+  int length = DpaJson::writeMessage( response, buffer, sizeof( buffer ) );
+  if ( writeMessageStream( response ) != string( buffer, length ) ) {
+    cout << "DpaJson output differs from ostringstream output" << endl;
+    return 1;
+  }
+
+  cout << "OS read response JSON (" << length << " chars), " << iterations << " iterations" << endl;
+
+  run( "ostringstream message:", iterations, [&]() {
+    return writeMessageStream( response ).size();
+  } );
+
+  run( "DpaJson message:      ", iterations, [&]() {
+    return static_cast<size_t>( DpaJson::writeMessage( response, buffer, sizeof( buffer ) ) );
+  } );
+
+  run( "DpaJson result:       ", iterations, [&]() {
+    return static_cast<size_t>( DpaJson::writeResult( result, buffer, sizeof( buffer ) ) );
+  } );
+
+  length = DpaJson::writeMessage( response, buffer, sizeof( buffer ) );
+  DpaMessage parsed;
+  run( "DpaJson read message: ", iterations, [&]() {
+    return DpaJson::readMessage( buffer, length, parsed ) ? static_cast<size_t>( parsed.GetLength() ) : 0;
+  } );
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "IChannel.h"
+#include "DpaMessage.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// \class LoopbackChannel
+/// \brief Channel answering each request as coordinator without hardware
+/// \details
+/// The response is passed to the receive handler by the channel thread as by a real channel.
+/// The response has the foursome and HWPID of the request with response flag, STATUS_NO_ERROR,
+/// DPA value 0 and RESPONSE_DATA_LENGTH bytes of data. Requests to nodes are answered the same way
+/// without confirmation, so the benchmarks use coordinator requests. The frames are kept in preallocated
+/// buffers, so the channel doesn't allocate and allocation counts of the handler are not distorted.
+class LoopbackChannel : public IChannel
+{
+public:
+  /// number of data bytes in response
+  static const int RESPONSE_DATA_LENGTH = 4;
+  /// number of requests waiting for the channel thread, more requests are dropped
+  static const int MAX_REQUESTS = 16;
+
+  LoopbackChannel()
+  {
+    for ( auto& request : m_requests ) {
+      request.reserve( DpaMessage::kMaxDpaMessageSize );
+    }
+    m_thread = std::thread( &LoopbackChannel::worker, this );
+  }
+
+  /// \brief Leave every n-th request unanswered, 0 answers all
+  void setDropEvery( int n )
+  {
+    std::lock_guard<std::mutex> lck( m_mutex );
+    m_dropEvery = n;
+  }
+
+  ~LoopbackChannel()
+  {
+    {
+      std::lock_guard<std::mutex> lck( m_mutex );
+      m_run = false;
+    }
+    m_condition.notify_all();
+    if ( m_thread.joinable() ) {
+      m_thread.join();
+    }
+  }
+
+  void sendTo( const std::basic_string<unsigned char>& message ) override
+  {
+    {
+      std::lock_guard<std::mutex> lck( m_mutex );
+      if ( m_dropEvery > 0 && ++m_sent % m_dropEvery == 0 ) {
+        return;
+      }
+      if ( m_count == MAX_REQUESTS ) {
+        return;
+      }
+      m_requests[( m_first + m_count ) % MAX_REQUESTS].assign( message );
+      m_count++;
+    }
+    m_condition.notify_one();
+  }
+
+  void registerReceiveFromHandler( ReceiveFromFunc receiveFromFunc ) override
+  {
+    std::lock_guard<std::mutex> lck( m_mutex );
+    m_receiveFromFunc = receiveFromFunc;
+  }
+
+  void unregisterReceiveFromHandler() override
+  {
+    std::lock_guard<std::mutex> lck( m_mutex );
+    m_receiveFromFunc = nullptr;
+  }
+
+  State getState() override { return State::Ready; }
+
+private:
+  void worker()
+  {
+    std::basic_string<unsigned char> request;
+    std::basic_string<unsigned char> response;
+    request.reserve( DpaMessage::kMaxDpaMessageSize );
+    response.reserve( DpaMessage::kMaxDpaMessageSize );
+
+    std::unique_lock<std::mutex> lck( m_mutex );
+    while ( true ) {
+      m_condition.wait( lck, [&] { return !m_run || m_count > 0; } );
+      if ( !m_run ) {
+        return;
+      }
+      request.swap( m_requests[m_first] );
+      m_first = ( m_first + 1 ) % MAX_REQUESTS;
+      m_count--;
+      // the handler registered by DpaHandler2 captures just a reference, copying it doesn't allocate
+      ReceiveFromFunc receiveFromFunc = m_receiveFromFunc;
+      lck.unlock();
+
+      if ( receiveFromFunc && request.size() >= sizeof( TDpaIFaceHeader ) ) {
+        response.assign( request, 0, sizeof( TDpaIFaceHeader ) );
+        response[3] |= 0x80;
+        response.push_back( STATUS_NO_ERROR );
+        response.push_back( 0 );
+        response.append( RESPONSE_DATA_LENGTH, 0x55 );
+        receiveFromFunc( response );
+      }
+
+      lck.lock();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  // ring of requests waiting for the channel thread
+  std::basic_string<unsigned char> m_requests[MAX_REQUESTS];
+  int m_first = 0;
+  int m_count = 0;
+  int m_dropEvery = 0;
+  unsigned m_sent = 0;
+  ReceiveFromFunc m_receiveFromFunc;
+  bool m_run = true;
+  std::thread m_thread;
+};
@@ -0,0 +1,97 @@
+/**
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures per transaction overhead of DpaHandler2 with loopback channel answering coordinator requests,
+// it reports time and context switches per transaction, queued and with inline execution
+// usage: TransactionBenchmark [transactions]
+
+#include "LoopbackChannel.h"
+#include "DpaHandler2.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#if defined( __linux__ )
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace {
+  // voluntary and involuntary context switches of the process
+  long contextSwitches()
+  {
+#if defined( __linux__ )
+    rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+#else
+    return 0;
+#endif
+  }
+
+  // runs transactions with given number of them submitted before waiting for the results
+  void run( const char* name, IDpaHandler2& handler, const DpaMessage& request, int transactions, int depth )
+  {
+    int errors = 0;
+    vector<shared_ptr<IDpaTransaction2>> pending;
+    pending.reserve( depth );
+
+    long switches = contextSwitches();
+    auto start = chrono::steady_clock::now();
+    for ( int i = 0; i < transactions; i += depth ) {
+      for ( int j = 0; j < depth; j++ ) {
+        pending.push_back( handler.executeDpaTransaction( request, -1 ) );
+      }
+      for ( auto& transaction : pending ) {
+        if ( transaction->get()->getErrorCode() != 0 ) {
+          errors++;
+        }
+      }
+      pending.clear();
+    }
+    double us = chrono::duration<double, micro>( chrono::steady_clock::now() - start ).count();
+    switches = contextSwitches() - switches;
+
+    cout << name << " " << us / transactions << " us, " << static_cast<double>( switches ) / transactions
+      << " context switches per transaction, errors: " << errors << endl;
+  }
+}
+
+int main( int argc, char** argv )
+{
+  int transactions = argc > 1 ? atoi( argv[1] ) : 20000;
+
+  // coordinator address info
+  const unsigned char addrInfo[] = { 0x00, 0x00, PNUM_COORDINATOR, CMD_COORDINATOR_ADDR_INFO, 0xff, 0xff };
+  DpaMessage request( addrInfo, static_cast<uint8_t>( sizeof( addrInfo ) ) );
+
+  LoopbackChannel channel;
+  DpaHandler2 handler( &channel );
+
+  cout << "Coordinator transactions over loopback channel: " << transactions << endl;
+  run( "serial:        ", handler, request, transactions, 1 );
+  run( "depth 8:       ", handler, request, transactions, 8 );
+
+  // synchronous transactions executed by the submitting thread while the queue is idle
+  handler.setInlineExecution( true );
+  run( "serial inline: ", handler, request, transactions, 1 );
+  run( "depth 8 inline:", handler, request, transactions, 8 );
+  return 0;
+}
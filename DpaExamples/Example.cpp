@@ -18,6 +18,7 @@
 #include "IqrfSpiChannel.h"
 
 #include "DpaHandler2.h"
+#include "DpaRequest.h"
 
 #include "IqrfTrace.h"
 #include "IqrfTraceHex.h"
@@ -35,6 +36,22 @@ void asynchronousMessageHandler(const DpaMessage& message) {
     << MEM_HEX((unsigned char *)message.DpaPacketData(), message.GetLength()));
 }
 
+// average latency of coordinator-local request in microseconds
+long long coordinatorLatencyUs(IDpaHandler2* dpaHandler, int count) {
+  DpaRequest<PNUM_COORDINATOR, CMD_COORDINATOR_ADDR_INFO> addrInfo;
+  DpaMessage dpaRequest = addrInfo.Build(COORDINATOR_ADDRESS);
+
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < count; i++) {
+    auto res = dpaHandler->executeDpaTransaction(dpaRequest, 1000)->get();
+    if (res->getErrorCode() != 0) {
+      TRC_WARNING("Address info failed: " << PAR(res->getErrorCode()));
+    }
+  }
+  auto duration = chrono::steady_clock::now() - start;
+  return chrono::duration_cast<chrono::microseconds>(duration).count() / count;
+}
+
 int main( int argc, char** argv ) {
 
   //TRC_START( "log.txt", iqrf::TrcLevel::Debug, 1000000 ); //tracing to ./log.txt
@@ -97,20 +114,23 @@ int main( int argc, char** argv ) {
   {
     bool run = true;
     int counter = 0;
+
+    // Coordinator-local latency through the queue worker and executed inline by this thread
+    const int latencyCount = 100;
+    dpaHandler->setInlineExecution(false);
+    cout << "Queued address info: " << coordinatorLatencyUs(dpaHandler, latencyCount) << " us\r\n";
+    dpaHandler->setInlineExecution(true);
+    cout << "Inline address info: " << coordinatorLatencyUs(dpaHandler, latencyCount) << " us\r\n";
+
+    // Pulse LEDR request, prepared once
+    DpaRequest<PNUM_LEDR, CMD_LED_PULSE> pulseLedr;
+
     while (run)
     {
       try
       {
-        // DPA message
-        DpaMessage dpaRequest;
-
-        // Pulse LEDR at [C]
-        dpaRequest.DpaPacket().DpaRequestPacket_t.NADR = 0x01;
-        dpaRequest.DpaPacket().DpaRequestPacket_t.PNUM = PNUM_LEDR;
-        dpaRequest.DpaPacket().DpaRequestPacket_t.PCMD = CMD_LED_PULSE;
-        dpaRequest.DpaPacket().DpaRequestPacket_t.HWPID = HWPID_DoNotCheck;
-        // Set request data length
-        dpaRequest.SetLength(sizeof(TDpaIFaceHeader));
+        // Pulse LEDR at [N] 0x01
+        DpaMessage dpaRequest = pulseLedr.Build(0x01);
 
         // Send DPA request
         cout << "Pulse LEDR\r\n";
@@ -37,7 +37,8 @@ namespace iqrf {
 
     bool isOn(TrcLevel level)
     {
-      return level <= m_level;
+      //messages are not formatted at all until the tracer is started, write() would drop them
+      return m_started && level <= m_level;
     }
 
     void write(const std::string& msg)
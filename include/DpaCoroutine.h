@@ -0,0 +1,267 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Opt-in header, it requires C++20 coroutines while the rest of the library is C++11
+#if __cplusplus >= 202002L && defined( __has_include )
+#if __has_include( <coroutine> )
+
+#include "IDpaHandler2.h"
+#include "DpaMessage.h"
+#include <atomic>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/// \class DpaTransactionAwaitable
+/// \brief Awaitable DPA transaction
+/// \details
+/// co_await queues the transaction by IDpaHandler2::executeDpaTransactionAsync() and suspends the coroutine.
+/// The coroutine is resumed from the completion path of the handler, i.e. by the completion executor
+/// set by IDpaHandler2::setCompletionExecutor(). With an executor posting tasks to an event loop all
+/// coroutines run in the event loop thread and no thread is blocked waiting for a transaction.
+///
+/// Example:
+/// \code
+/// DpaTask<int> readTemperature( IDpaHandler2& dpa )
+/// {
+///   std::unique_ptr<IDpaTransactionResult2> res = co_await dpaTransaction( dpa, request, -1 );
+///   co_return res->getErrorCode();
+/// }
+/// \endcode
+class DpaTransactionAwaitable
+{
+public:
+  DpaTransactionAwaitable( IDpaHandler2& dpaHandler, const DpaMessage& request, int32_t timeout )
+    : m_dpaHandler( dpaHandler ), m_request( request ), m_timeout( timeout )
+  {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend( std::coroutine_handle<> handle )
+  {
+    m_handle = handle;
+    m_dpaHandler.executeDpaTransactionAsync( m_request, m_timeout, [this]( std::unique_ptr<IDpaTransactionResult2> result ) {
+      m_result = std::move( result );
+      // resume only if the coroutine has been suspended already, otherwise await_suspend() continues
+      if ( m_state.exchange( kCompleted ) == kSuspended ) {
+        m_handle.resume();
+      }
+    } );
+    return m_state.exchange( kSuspended ) != kCompleted;
+  }
+
+  std::unique_ptr<IDpaTransactionResult2> await_resume() { return std::move( m_result ); }
+
+private:
+  enum State { kQueued, kSuspended, kCompleted };
+
+  IDpaHandler2& m_dpaHandler;
+  DpaMessage m_request;
+  int32_t m_timeout;
+  std::coroutine_handle<> m_handle;
+  std::unique_ptr<IDpaTransactionResult2> m_result;
+  std::atomic<int> m_state { kQueued };
+};
+
+/// \brief Make awaitable DPA transaction
+/// \param [in] dpaHandler handler executing the transaction
+/// \param [in] request DPA request
+/// \param [in] timeout timeout as in IDpaHandler2::executeDpaTransaction()
+/// \return awaitable giving std::unique_ptr<IDpaTransactionResult2>
+inline DpaTransactionAwaitable dpaTransaction( IDpaHandler2& dpaHandler, const DpaMessage& request, int32_t timeout )
+{
+  return DpaTransactionAwaitable( dpaHandler, request, timeout );
+}
+
+/// \class DpaTask
+/// \brief Lazily started coroutine task of DPA workflows
+/// \details
+/// The task starts when it is awaited by another task or by start(). The awaiting coroutine is resumed
+/// by symmetric transfer when the task finishes. The task object owns the coroutine frame and it has
+/// to be kept alive until done() for tasks started by start().
+template <typename T>
+class DpaTask
+{
+public:
+  struct promise_type
+  {
+    T m_value {};
+    std::exception_ptr m_exception;
+    std::coroutine_handle<> m_continuation;
+
+    DpaTask get_return_object() { return DpaTask( std::coroutine_handle<promise_type>::from_promise( *this ) ); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter
+    {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend( std::coroutine_handle<promise_type> handle ) noexcept
+      {
+        std::coroutine_handle<> continuation = handle.promise().m_continuation;
+        return continuation ? continuation : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_value( T value ) { m_value = std::move( value ); }
+    void unhandled_exception() { m_exception = std::current_exception(); }
+  };
+
+  DpaTask( DpaTask&& other ) noexcept : m_handle( std::exchange( other.m_handle, nullptr ) ) {}
+  DpaTask& operator=( DpaTask&& other ) noexcept
+  {
+    if ( this != &other ) {
+      if ( m_handle ) {
+        m_handle.destroy();
+      }
+      m_handle = std::exchange( other.m_handle, nullptr );
+    }
+    return *this;
+  }
+  DpaTask( const DpaTask& ) = delete;
+  DpaTask& operator=( const DpaTask& ) = delete;
+
+  ~DpaTask()
+  {
+    if ( m_handle ) {
+      m_handle.destroy();
+    }
+  }
+
+  /// \brief Start not awaited task
+  void start() { m_handle.resume(); }
+  /// \brief Check if the task finished
+  bool done() const { return m_handle.done(); }
+  /// \brief Get result of finished task, rethrows exception of the task
+  T result()
+  {
+    if ( m_handle.promise().m_exception ) {
+      std::rethrow_exception( m_handle.promise().m_exception );
+    }
+    return std::move( m_handle.promise().m_value );
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ) noexcept
+  {
+    m_handle.promise().m_continuation = awaiting;
+    return m_handle;
+  }
+  T await_resume() { return result(); }
+
+private:
+  explicit DpaTask( std::coroutine_handle<promise_type> handle ) : m_handle( handle ) {}
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+/// Results of FRC send followed by FRC extra result
+struct DpaFrcResults
+{
+  std::unique_ptr<IDpaTransactionResult2> send;
+  /// nullptr if FRC send failed
+  std::unique_ptr<IDpaTransactionResult2> extraResult;
+};
+
+/// \brief FRC send (selective) followed by FRC extra result
+/// \details
+/// Extra result is requested only if FRC send succeeded. Other transactions queued meanwhile
+/// can be executed between the two steps.
+/// \param [in] dpaHandler handler executing the transactions
+/// \param [in] frcSend CMD_FRC_SEND or CMD_FRC_SEND_SELECTIVE request
+/// \param [in] timeout timeout of FRC send
+inline DpaTask<DpaFrcResults> frcSendWithExtraResult( IDpaHandler2& dpaHandler, DpaMessage frcSend, int32_t timeout )
+{
+  DpaFrcResults results;
+  results.send = co_await dpaTransaction( dpaHandler, frcSend, timeout );
+
+  if ( results.send && results.send->getErrorCode() == IDpaTransactionResult2::TRN_OK ) {
+    DpaMessage extraResult;
+    uint8_t* data = extraResult.DpaPacketData();
+    data[2] = PNUM_FRC;
+    data[3] = CMD_FRC_EXTRARESULT;
+    extraResult.SetNodeAddress( frcSend.NodeAddress() );
+    extraResult.SetHwpid( frcSend.Hwpid() );
+    extraResult.SetLength<sizeof( TDpaIFaceHeader )>();
+    results.extraResult = co_await dpaTransaction( dpaHandler, extraResult, -1 );
+  }
+
+  co_return results;
+}
+
+/// \brief Read, modify and write node EEPROM
+/// \param [in] dpaHandler handler executing the transactions
+/// \param [in] nadr node address
+/// \param [in] address EEPROM address
+/// \param [in] length number of bytes to read and write back
+/// \param [in] modify modifies the read data in place, the data are written if it returns true
+/// \param [in] timeout timeout of both transactions
+/// \return result of the write or of the failed read (read result if modify returns false)
+inline DpaTask<std::unique_ptr<IDpaTransactionResult2>> readModifyWriteEeprom( IDpaHandler2& dpaHandler, uint16_t nadr,
+  uint8_t address, uint8_t length, std::function<bool( uint8_t* data, int length )> modify, int32_t timeout = -1 )
+{
+  static const int DATA_INDEX = sizeof( TDpaIFaceHeader );
+  static const int RESPONSE_DATA_INDEX = sizeof( TDpaIFaceHeader ) + 2;
+
+  if ( length == 0 || length > DPA_MAX_DATA_LENGTH - MEMORY_WRITE_REQUEST_OVERHEAD ) {
+    throw std::length_error( "Invalid EEPROM data length." );
+  }
+
+  DpaMessage read;
+  uint8_t* data = read.DpaPacketData();
+  data[2] = PNUM_EEPROM;
+  data[3] = CMD_EEPROM_READ;
+  data[DATA_INDEX] = address;
+  data[DATA_INDEX + 1] = length;
+  read.SetNodeAddress( nadr );
+  read.SetHwpid( HWPID_DoNotCheck );
+  read.SetLength( DATA_INDEX + 2 );
+
+  std::unique_ptr<IDpaTransactionResult2> readResult = co_await dpaTransaction( dpaHandler, read, timeout );
+  if ( !readResult || readResult->getErrorCode() != IDpaTransactionResult2::TRN_OK ||
+    readResult->getResponse().GetLength() < RESPONSE_DATA_INDEX + length ) {
+    co_return readResult;
+  }
+
+  uint8_t buffer[DPA_MAX_DATA_LENGTH];
+  std::memcpy( buffer, readResult->getResponse().DpaPacketData() + RESPONSE_DATA_INDEX, length );
+  if ( !modify( buffer, length ) ) {
+    co_return readResult;
+  }
+
+  DpaMessage write;
+  data = write.DpaPacketData();
+  data[2] = PNUM_EEPROM;
+  data[3] = CMD_EEPROM_WRITE;
+  data[DATA_INDEX] = address;
+  std::memcpy( data + DATA_INDEX + 1, buffer, length );
+  write.SetNodeAddress( nadr );
+  write.SetHwpid( HWPID_DoNotCheck );
+  write.SetLength( DATA_INDEX + 1 + length );
+
+  co_return co_await dpaTransaction( dpaHandler, write, timeout );
+}
+
+#endif
+#endif
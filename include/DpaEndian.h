@@ -0,0 +1,144 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined( _MSC_VER )
+#include <stdlib.h>
+#endif
+
+/// \class DpaEndian
+/// \brief Alignment safe little endian loads and stores
+/// \details
+/// DPA data are little endian and packed, so multi-byte values can be at odd addresses.
+/// The values are accessed by memcpy which compiles to a single (unaligned capable) load or store
+/// where the platform allows it and to byte accesses elsewhere. The bytes are swapped at big endian host only.
+class DpaEndian
+{
+public:
+  /// \brief Check host byte order
+  /// \return true at little endian host
+  static bool isLittleEndianHost()
+  {
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return false;
+#else
+    return true;
+#endif
+  }
+
+  static uint16_t loadLe16(const void* src)
+  {
+    uint16_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return isLittleEndianHost() ? value : swap16(value);
+  }
+
+  static uint32_t loadLe32(const void* src)
+  {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return isLittleEndianHost() ? value : swap32(value);
+  }
+
+  static uint64_t loadLe64(const void* src)
+  {
+    uint64_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return isLittleEndianHost() ? value : swap64(value);
+  }
+
+  static void storeLe16(void* dst, uint16_t value)
+  {
+    value = isLittleEndianHost() ? value : swap16(value);
+    std::memcpy(dst, &value, sizeof(value));
+  }
+
+  static void storeLe32(void* dst, uint32_t value)
+  {
+    value = isLittleEndianHost() ? value : swap32(value);
+    std::memcpy(dst, &value, sizeof(value));
+  }
+
+  static void storeLe64(void* dst, uint64_t value)
+  {
+    value = isLittleEndianHost() ? value : swap64(value);
+    std::memcpy(dst, &value, sizeof(value));
+  }
+
+  /// \brief Load value of 1, 2 or 4 bytes integral type
+  template <typename T>
+  static T load(const void* src)
+  {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "Unsupported size.");
+    return sizeof(T) == 1 ? static_cast<T>(*static_cast<const uint8_t*>(src)) :
+      sizeof(T) == 2 ? static_cast<T>(loadLe16(src)) : static_cast<T>(loadLe32(src));
+  }
+
+  /// \brief Store value of 1, 2 or 4 bytes integral type
+  template <typename T>
+  static void store(void* dst, T value)
+  {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "Unsupported size.");
+    if (sizeof(T) == 1) {
+      *static_cast<uint8_t*>(dst) = static_cast<uint8_t>(value);
+    }
+    else if (sizeof(T) == 2) {
+      storeLe16(dst, static_cast<uint16_t>(value));
+    }
+    else {
+      storeLe32(dst, static_cast<uint32_t>(value));
+    }
+  }
+
+private:
+  static uint16_t swap16(uint16_t x)
+  {
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_bswap16(x);
+#elif defined( _MSC_VER )
+    return _byteswap_ushort(x);
+#else
+    return static_cast<uint16_t>((x >> 8) | (x << 8));
+#endif
+  }
+
+  static uint32_t swap32(uint32_t x)
+  {
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_bswap32(x);
+#elif defined( _MSC_VER )
+    return _byteswap_ulong(x);
+#else
+    return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+#endif
+  }
+
+  static uint64_t swap64(uint64_t x)
+  {
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_bswap64(x);
+#elif defined( _MSC_VER )
+    return _byteswap_uint64(x);
+#else
+    return (static_cast<uint64_t>(swap32(static_cast<uint32_t>(x))) << 32) | swap32(static_cast<uint32_t>(x >> 32));
+#endif
+  }
+};
@@ -0,0 +1,95 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DpaEndian.h"
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "DPA.h"
+#ifdef __cplusplus
+}
+#endif
+
+/// List of all multi-byte fields of packed DPA.h structures, X(structure, field)
+#define DPA_MULTIBYTE_FIELDS(X) \
+  X(TDpaIFaceHeader, HWPID) \
+  X(TEnumPeripheralsAnswer, DpaVersion) \
+  X(TEnumPeripheralsAnswer, HWPID) \
+  X(TEnumPeripheralsAnswer, HWPIDver) \
+  X(TPerNodeRead_Response, ntwUSERADDRESS) \
+  X(TPerNodeRead_Response, ntwID) \
+  X(TPerOSRead_Response, OsBuild) \
+  X(TPerOSRead_Response, DpaVersion) \
+  X(TPerOSRead_Response, HWPID) \
+  X(TPerOSRead_Response, HWPIDver) \
+  X(TPerOSLoadCode_Request, Address) \
+  X(TPerOSLoadCode_Request, Length) \
+  X(TPerOSLoadCode_Request, CheckSum) \
+  X(TPerOSSleep_Request, Time) \
+  X(TPerOSTestRfSignal_Request, Time) \
+  X(TPerXMemoryRequest, Address) \
+  X(TPerIODelay, Delay) \
+  X(TPerThermometerRead_Response, SixteenthValue)
+
+/// \class DpaFields
+/// \brief Accessors of multi-byte fields of packed DPA.h structures
+/// \details
+/// The accessors are generated from DPA_MULTIBYTE_FIELDS list as get<Field>() and set<Field>()
+/// overloaded by the structure type. The values are loaded and stored by DpaEndian so they are
+/// correct for unaligned fields and at big endian host.
+///
+/// Example:
+/// \code
+/// DpaResponseView<TPerOSRead_Response> osRead( *res );
+/// uint16_t osBuild = DpaFields::getOsBuild( *osRead );
+/// \endcode
+class DpaFields
+{
+public:
+#define DPA_FIELD_ACCESSORS(Struct, Field) \
+  static decltype(Struct::Field) get##Field(const Struct& s) \
+  { \
+    return DpaEndian::load<decltype(Struct::Field)>(reinterpret_cast<const uint8_t*>(&s) + offsetof(Struct, Field)); \
+  } \
+  static void set##Field(Struct& s, decltype(Struct::Field) value) \
+  { \
+    DpaEndian::store(reinterpret_cast<uint8_t*>(&s) + offsetof(Struct, Field), value); \
+  }
+
+  DPA_MULTIBYTE_FIELDS(DPA_FIELD_ACCESSORS)
+
+#undef DPA_FIELD_ACCESSORS
+
+  /// Offset of HWPID in DP2P request packet, TDP2Prequest is declared by DPA.h for the device (__CC5X__) only
+  static const size_t DP2P_REQUEST_HWPID_OFFSET = 3 + 30 + 1 + 1 + 1;
+
+  /// HWPID of DP2P request packet (TDP2Prequest.HWPID)
+  static uint16_t getDp2pRequestHWPID(const uint8_t* packet)
+  {
+    return DpaEndian::loadLe16(packet + DP2P_REQUEST_HWPID_OFFSET);
+  }
+
+  static void setDp2pRequestHWPID(uint8_t* packet, uint16_t value)
+  {
+    DpaEndian::storeLe16(packet + DP2P_REQUEST_HWPID_OFFSET, value);
+  }
+};
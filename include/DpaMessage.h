@@ -32,6 +32,8 @@ extern "C" {
 }
 #endif
 
+#include "DpaEndian.h"
+
 #if defined _WIN32 || defined _WIN64
 #ifndef WIN32
 #define WIN32
@@ -94,19 +96,16 @@ public:
   };
 
   /** Default constructor */
-  DpaMessage() : m_length(0) {
-    m_dpa_packet = ant_new DpaPacket_t();
+  DpaMessage() : m_dpa_packet(), m_length(0) {
   }
 
   /** Constructor from data */
-  DpaMessage(const unsigned char* data, uint8_t length) {
-    m_dpa_packet = ant_new DpaPacket_t();
+  DpaMessage(const unsigned char* data, uint8_t length) : m_dpa_packet(), m_length(0) {
     DataToBuffer(data, length);
   }
 
   /** Constructor from string */
-  DpaMessage(const std::basic_string<unsigned char>& message) {
-    m_dpa_packet = ant_new DpaPacket_t();
+  DpaMessage(const std::basic_string<unsigned char>& message) : m_dpa_packet(), m_length(0) {
     DataToBuffer(message.data(), static_cast<uint8_t>(message.length()));
   }
 
@@ -116,30 +115,49 @@ public:
    @param	other the original message
    */
   DpaMessage(const DpaMessage& other) : m_length(other.m_length) {
-    m_dpa_packet = ant_new DpaPacket_t();
-    std::copy(other.m_dpa_packet->Buffer, other.m_dpa_packet->Buffer + other.m_length, this->m_dpa_packet->Buffer);
+    CopyPacket(other);
   }
 
-  /** Destructor. */
-  virtual ~DpaMessage() {
-    delete m_dpa_packet;
+  /**
+   Move constructor
+
+   The packet is stored inline, so moving is a plain copy of the valid bytes.
+   The source keeps its content.
+
+   @param	other the original message
+   */
+  DpaMessage(DpaMessage&& other) noexcept : m_length(other.m_length) {
+    CopyPacket(other);
   }
 
   /**
    Assignment operator
 
    @param	other the original message
-   @return	A shallow copy of this object
+   @return	A deep copy of this object
    */
   DpaMessage& operator=(const DpaMessage& other) {
     if (this == &other)
       return *this;
 
-    delete m_dpa_packet;
-    m_dpa_packet = ant_new DpaPacket_t();
+    m_length = other.m_length;
+    CopyPacket(other);
+
+    return *this;
+  }
+
+  /**
+   Move assignment operator
+
+   @param	other the original message
+   @return	this with data of the original message
+   */
+  DpaMessage& operator=(DpaMessage&& other) noexcept {
+    if (this == &other)
+      return *this;
 
-    std::copy(other.m_dpa_packet->Buffer, other.m_dpa_packet->Buffer + other.m_length, this->m_dpa_packet->Buffer);
     m_length = other.m_length;
+    CopyPacket(other);
 
     return *this;
   }
@@ -202,16 +220,53 @@ public:
   @param	length					The number of bytes to be stored
   */
   void DataToBuffer(const unsigned char* data, uint8_t length) {
-    if (length == 0)
+    if (TryDataToBuffer(data, length))
       return;
 
     if (data == nullptr)
       throw std::invalid_argument("Data argument can not be null.");
 
-    if (length > kMaxDpaMessageSize)
+    throw std::length_error("Not enough space for this data.");
+  }
+
+  /**
+  Stores data to message buffer without throwing
+
+  @param	data	Pointer to data
+  @param	length	The number of bytes to be stored, nothing is stored if 0
+
+  @return	false if data is nullptr or length is bigger than max buffer size, message is unchanged then
+  */
+  bool TryDataToBuffer(const unsigned char* data, int length) {
+    if (length == 0)
+      return true;
+
+    if (data == nullptr || length < 0 || length > kMaxDpaMessageSize)
+      return false;
+
+    std::copy(data, data + length, m_dpa_packet.Buffer);
+    m_length = length;
+    return true;
+  }
+
+  /**
+  Replaces message content with data, the rest of the buffer is cleared as by assignment of a message
+
+  @exception	std::invalid_argument	Thrown when data is nullptr and length is not 0
+  @exception	std::length_error	 	Raised when a length is negative or bigger than max buffer size
+
+  @param	data	Pointer to data
+  @param	length	The number of bytes to be stored, the message is emptied if 0
+  */
+  void AssignData(const unsigned char* data, int length) {
+    if (length < 0 || length > kMaxDpaMessageSize)
       throw std::length_error("Not enough space for this data.");
 
-    std::copy(data, data + length, m_dpa_packet->Buffer);
+    if (data == nullptr && length > 0)
+      throw std::invalid_argument("Data argument can not be null.");
+
+    std::copy(data, data + length, m_dpa_packet.Buffer);
+    std::fill(m_dpa_packet.Buffer + length, m_dpa_packet.Buffer + kMaxDpaMessageSize, 0);
     m_length = length;
   }
 
@@ -228,9 +283,32 @@ public:
   @param	length The number of bytes to be set
   */
   void SetLength(int length) {
-    if (length > kMaxDpaMessageSize || length <= 0)
+    if (!TrySetLength(length))
       throw std::length_error("Invalid length value.");
+  }
+
+  /**
+  Sets length of data stored in message without throwing
+
+  @param	length The number of bytes to be set
+  @return	false if length is out of range, length is unchanged then
+  */
+  bool TrySetLength(int length) {
+    if (length > kMaxDpaMessageSize || length <= 0)
+      return false;
     m_length = length;
+    return true;
+  }
+
+  /**
+  Sets length of data stored in message, checked at compile time
+
+  @tparam	Length The number of bytes to be set
+  */
+  template <int Length>
+  void SetLength() {
+    static_assert(Length > 0 && Length <= kMaxDpaMessageSize, "Invalid length value.");
+    m_length = Length;
   }
 
   /**
@@ -238,21 +316,42 @@ public:
 
    @return	An address
    */
-  uint16_t NodeAddress() const { return m_dpa_packet->DpaRequestPacket_t.NADR; }
+  uint16_t NodeAddress() const { return DpaEndian::loadLe16(m_dpa_packet.Buffer + kNadrIndex); }
+
+  /**
+   Sets destination address of request
+
+   @param	nadr An address
+   */
+  void SetNodeAddress(uint16_t nadr) { DpaEndian::storeLe16(m_dpa_packet.Buffer + kNadrIndex, nadr); }
+
+  /**
+   Gets HWPID
+
+   @return	A HWPID
+   */
+  uint16_t Hwpid() const { return DpaEndian::loadLe16(m_dpa_packet.Buffer + kHwpidIndex); }
+
+  /**
+   Sets HWPID of request
+
+   @param	hwpid A HWPID
+   */
+  void SetHwpid(uint16_t hwpid) { DpaEndian::storeLe16(m_dpa_packet.Buffer + kHwpidIndex, hwpid); }
 
   /**
    Gets peripheral type
 
    @return	A peripheral type
  */
-  TDpaPeripheralType PeripheralType() const { return TDpaPeripheralType(m_dpa_packet->DpaRequestPacket_t.PNUM); }
+  TDpaPeripheralType PeripheralType() const { return TDpaPeripheralType(m_dpa_packet.DpaRequestPacket_t.PNUM); }
 
   /**
    Gets command code
 
    @return	A peripheral command
    */
-  uint8_t PeripheralCommand() const { return m_dpa_packet->DpaResponsePacket_t.PCMD; }
+  uint8_t PeripheralCommand() const { return m_dpa_packet.DpaResponsePacket_t.PCMD; }
 
   /**
    Gets response code from received message
@@ -262,10 +361,25 @@ public:
    @return	A response code
    */
   TErrorCodes ResponseCode() const {
-    if (MessageDirection() != kResponse)
+    TErrorCodes responseCode;
+    if (!TryResponseCode(responseCode))
       throw std::logic_error("Only response packet has response error defined.");
 
-    return TErrorCodes(m_dpa_packet->DpaResponsePacket_t.ResponseCode);
+    return responseCode;
+  }
+
+  /**
+   Gets response code from received message without throwing
+
+   @param [out]	responseCode A response code, unchanged if message is not a response
+   @return	false if message is not a response
+   */
+  bool TryResponseCode(TErrorCodes& responseCode) const {
+    if (MessageDirection() != kResponse)
+      return false;
+
+    responseCode = TErrorCodes(m_dpa_packet.DpaResponsePacket_t.ResponseCode);
+    return true;
   }
 
   /**
@@ -273,26 +387,34 @@ public:
 
    @return	A reference to a const DpaPacket_t
    */
-  DpaPacket_t& DpaPacket() { return *m_dpa_packet; }
-  const DpaPacket_t& DpaPacket() const { return *m_dpa_packet; }
+  DpaPacket_t& DpaPacket() { return m_dpa_packet; }
+  const DpaPacket_t& DpaPacket() const { return m_dpa_packet; }
 
   /**
    Gets pointer to data stored in message
 
    @return	Pointer to data stored in message
    */
-  unsigned char* DpaPacketData() { return m_dpa_packet->Buffer; }
-  const unsigned char* DpaPacketData() const { return m_dpa_packet->Buffer; }
+  unsigned char* DpaPacketData() { return m_dpa_packet.Buffer; }
+  const unsigned char* DpaPacketData() const { return m_dpa_packet.Buffer; }
 
 private:
-  const int kCommandIndex = 0x03;
-  const int kStatusCodeIndex = 0x06;
+  static const int kNadrIndex = 0x00;
+  static const int kCommandIndex = 0x03;
+  static const int kHwpidIndex = 0x04;
+  static const int kStatusCodeIndex = 0x06;
 
-  DpaPacket_t *m_dpa_packet;
+  DpaPacket_t m_dpa_packet;
   int m_length;
 
+  /** Copies valid bytes of the other message, the rest of the buffer is cleared */
+  void CopyPacket(const DpaMessage& other) {
+    std::copy(other.m_dpa_packet.Buffer, other.m_dpa_packet.Buffer + other.m_length, m_dpa_packet.Buffer);
+    std::fill(m_dpa_packet.Buffer + other.m_length, m_dpa_packet.Buffer + kMaxDpaMessageSize, 0);
+  }
+
   bool IsConfirmationMessage() const {
-    auto responseCode = TErrorCodes(m_dpa_packet->DpaResponsePacket_t.ResponseCode);
+    auto responseCode = TErrorCodes(m_dpa_packet.DpaResponsePacket_t.ResponseCode);
 
     if (responseCode == STATUS_CONFIRMATION)
       return true;
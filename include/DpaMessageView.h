@@ -0,0 +1,173 @@
+/**
+ * Copyright 2015-2017 MICRORISC s.r.o.
+ * Copyright 2017 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DpaMessage.h"
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+/**
+ Non-owning read-only view of a DPA message
+
+ The view refers to bytes owned by someone else (typically the receive buffer of a channel)
+ and provides the same accessors as DpaMessage without copying the data. The referenced
+ buffer has to outlive the view. Use ToMessage() to get an owning copy when the message is kept.
+ */
+class DpaMessageView {
+public:
+  /** Default constructor, empty view */
+  DpaMessageView() : m_data(nullptr), m_length(0) {}
+
+  /** Constructor from data */
+  DpaMessageView(const unsigned char* data, int length)
+    : m_data(data), m_length(data != nullptr && length > 0 ? length : 0) {}
+
+  /** Constructor from string */
+  explicit DpaMessageView(const std::basic_string<unsigned char>& message)
+    : m_data(message.data()), m_length(static_cast<int>(message.length())) {}
+
+  /** Constructor from message */
+  explicit DpaMessageView(const DpaMessage& message)
+    : m_data(message.DpaPacketData()), m_length(message.GetLength()) {}
+
+  /**
+   Gets message type
+
+   @return	A MessageType
+   */
+  DpaMessage::MessageType MessageDirection() const {
+    if (m_length < kCommandIndex)
+      return DpaMessage::kRequest;
+
+    if (PeripheralCommand() & 0x80)
+      return DpaMessage::kResponse;
+
+    if (m_length > kStatusCodeIndex && Byte(kResponseCodeIndex) == STATUS_CONFIRMATION)
+      return DpaMessage::kConfirmation;
+
+    return DpaMessage::kRequest;
+  }
+
+  /**
+   Gets length of data referenced by the view
+
+   @return	Number of bytes in message
+   */
+  int GetLength() const { return m_length; }
+
+  /**
+   Gets destination or source address of sender/receiver
+
+   @return	An address
+   */
+  uint16_t NodeAddress() const {
+    if (m_length < kNadrIndex + 2)
+      return Byte(kNadrIndex);
+
+    return DpaEndian::loadLe16(m_data + kNadrIndex);
+  }
+
+  /**
+   Gets peripheral type
+
+   @return	A peripheral type
+   */
+  TDpaPeripheralType PeripheralType() const { return TDpaPeripheralType(Byte(kPnumIndex)); }
+
+  /**
+   Gets command code
+
+   @return	A peripheral command
+   */
+  uint8_t PeripheralCommand() const { return Byte(kPcmdIndex); }
+
+  /**
+   Gets response code from received message
+
+   @exception	std::logic_error	Thrown when message is not a response
+
+   @return	A response code
+   */
+  TErrorCodes ResponseCode() const {
+    TErrorCodes responseCode;
+    if (!TryResponseCode(responseCode))
+      throw std::logic_error("Only response packet has response error defined.");
+
+    return responseCode;
+  }
+
+  /**
+   Gets response code from received message without throwing
+
+   @param [out]	responseCode A response code, unchanged if message is not a response
+   @return	false if message is not a response
+   */
+  bool TryResponseCode(TErrorCodes& responseCode) const {
+    if (MessageDirection() != DpaMessage::kResponse)
+      return false;
+
+    responseCode = TErrorCodes(Byte(kResponseCodeIndex));
+    return true;
+  }
+
+  /**
+   Gets pointer to data referenced by the view
+
+   @return	Pointer to data
+   */
+  const unsigned char* DpaPacketData() const { return m_data; }
+
+  /**
+   Makes an owning copy of the referenced data
+
+   @exception	std::length_error	Raised when the view is longer than max buffer size
+
+   @return	A message with a copy of the data
+   */
+  DpaMessage ToMessage() const {
+    DpaMessage message;
+    CopyTo(message);
+    return message;
+  }
+
+  /**
+   Replaces content of the message with a copy of the referenced data, the same as assignment of a message
+
+   @exception	std::length_error	Raised when the view is longer than max buffer size
+
+   @param [out]	message	The message to be filled
+   */
+  void CopyTo(DpaMessage& message) const {
+    message.AssignData(m_data, m_length);
+  }
+
+private:
+  static const int kNadrIndex = 0x00;
+  static const int kPnumIndex = 0x02;
+  static const int kPcmdIndex = 0x03;
+  static const int kResponseCodeIndex = 0x06;
+  static const int kCommandIndex = 0x03;
+  static const int kStatusCodeIndex = 0x06;
+
+  const unsigned char* m_data;
+  int m_length;
+
+  /** Byte at index or 0 if out of the referenced data, same as the cleared tail of DpaMessage */
+  uint8_t Byte(int index) const { return index < m_length ? m_data[index] : 0; }
+};
@@ -0,0 +1,256 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DpaMessage.h"
+#include "DpaEndian.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+/// Marker of DPA requests without PData
+struct DpaNoPayload {};
+
+/// Payload of CMD_OS_BATCH, embedded requests are terminated by zero length byte
+struct DpaBatchPayload
+{
+  uint8_t Requests[DPA_MAX_DATA_LENGTH];
+};
+
+#pragma pack( push, 1 )
+
+/// Payload of CMD_RAM_READ and CMD_EEPROM_READ, read part of TPerMemoryRequest with its fixed size
+typedef struct
+{
+  uns8 Address;
+  uns8 Length;
+} STRUCTATTR DpaMemoryReadPayload;
+
+/// Payload of CMD_EEEPROM_XREAD, read part of TPerXMemoryRequest with its fixed size
+typedef struct
+{
+  uns16 Address;
+  uns8 Length;
+} STRUCTATTR DpaXMemoryReadPayload;
+
+#pragma pack( pop )
+
+/// \brief Maps peripheral number and command to request payload structure from DPA.h
+/// \details
+/// Only the known commands are specialized, unknown combination doesn't compile.
+/// Requests with variable length (FRC send, batch, validate bonds, memory write, ...) are mapped to the
+/// payload of maximal size, the used part is given to Build() by its length. Memory reads have fixed
+/// size payloads, the read part of the DPA.h structure.
+template <uint8_t Pnum, uint8_t Pcmd>
+struct DpaRequestPayload;
+
+#define DPA_REQUEST_PAYLOAD(pnum, pcmd, type) \
+template <> struct DpaRequestPayload<pnum, pcmd> { typedef type Type; };
+
+// Coordinator
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_ADDR_INFO, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_DISCOVERED_DEVICES, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_BONDED_DEVICES, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_CLEAR_ALL_BONDS, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_BOND_NODE, TPerCoordinatorBondNode_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_REMOVE_BOND, TPerCoordinatorRemoveBond_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_DISCOVERY, TPerCoordinatorDiscovery_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_SET_DPAPARAMS, TPerCoordinatorSetDpaParams_Request_Response)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_SET_HOPS, TPerCoordinatorSetHops_Request_Response)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_BACKUP, TPerCoordinatorNodeBackup_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_RESTORE, TPerCoordinatorNodeRestore_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_AUTHORIZE_BOND, TPerCoordinatorAuthorizeBond_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_SMART_CONNECT, TPerCoordinatorSmartConnect_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_SET_MID, TPerCoordinatorSetMID_Request)
+DPA_REQUEST_PAYLOAD(PNUM_COORDINATOR, CMD_COORDINATOR_BRIDGE, TPerCoordinatorBridge_Request)
+
+// Node
+DPA_REQUEST_PAYLOAD(PNUM_NODE, CMD_NODE_READ, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_NODE, CMD_NODE_REMOVE_BOND, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_NODE, CMD_NODE_BACKUP, TPerCoordinatorNodeBackup_Request)
+DPA_REQUEST_PAYLOAD(PNUM_NODE, CMD_NODE_RESTORE, TPerCoordinatorNodeRestore_Request)
+DPA_REQUEST_PAYLOAD(PNUM_NODE, CMD_NODE_VALIDATE_BONDS, TPerNodeValidateBonds_Request)
+
+// OS
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_READ, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_RESET, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_READ_CFG, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_RFPGM, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_SLEEP, TPerOSSleep_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_BATCH, DpaBatchPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_SELECTIVE_BATCH, TPerOSSelectiveBatch_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_SET_SECURITY, TPerOSSetSecurity_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_INDICATE, TPerOSIndicate_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_RESTART, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_LOAD_CODE, TPerOSLoadCode_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_TEST_RF_SIGNAL, TPerOSTestRfSignal_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_FACTORY_SETTINGS, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_WRITE_CFG, TPerOSWriteCfg_Request)
+DPA_REQUEST_PAYLOAD(PNUM_OS, CMD_OS_WRITE_CFG_BYTE, TPerOSWriteCfgByte_Request)
+
+// Memory
+DPA_REQUEST_PAYLOAD(PNUM_RAM, CMD_RAM_READ, DpaMemoryReadPayload)
+DPA_REQUEST_PAYLOAD(PNUM_RAM, CMD_RAM_WRITE, TPerMemoryRequest)
+DPA_REQUEST_PAYLOAD(PNUM_EEPROM, CMD_EEPROM_READ, DpaMemoryReadPayload)
+DPA_REQUEST_PAYLOAD(PNUM_EEPROM, CMD_EEPROM_WRITE, TPerMemoryRequest)
+DPA_REQUEST_PAYLOAD(PNUM_EEEPROM, CMD_EEEPROM_XREAD, DpaXMemoryReadPayload)
+DPA_REQUEST_PAYLOAD(PNUM_EEEPROM, CMD_EEEPROM_XWRITE, TPerXMemoryRequest)
+
+// LEDs
+DPA_REQUEST_PAYLOAD(PNUM_LEDR, CMD_LED_SET_OFF, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDR, CMD_LED_SET_ON, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDR, CMD_LED_PULSE, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDR, CMD_LED_FLASHING, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDG, CMD_LED_SET_OFF, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDG, CMD_LED_SET_ON, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDG, CMD_LED_PULSE, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_LEDG, CMD_LED_FLASHING, DpaNoPayload)
+
+// IO, Thermometer, UART
+DPA_REQUEST_PAYLOAD(PNUM_IO, CMD_IO_DIRECTION, TPerIoDirectionAndSet_Request)
+DPA_REQUEST_PAYLOAD(PNUM_IO, CMD_IO_SET, TPerIoDirectionAndSet_Request)
+DPA_REQUEST_PAYLOAD(PNUM_IO, CMD_IO_GET, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_THERMOMETER, CMD_THERMOMETER_READ, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_UART, CMD_UART_OPEN, TPerUartOpen_Request)
+DPA_REQUEST_PAYLOAD(PNUM_UART, CMD_UART_CLOSE, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_UART, CMD_UART_WRITE_READ, TPerUartWriteRead_Request)
+DPA_REQUEST_PAYLOAD(PNUM_UART, CMD_UART_CLEAR_WRITE_READ, TPerUartWriteRead_Request)
+
+// FRC
+DPA_REQUEST_PAYLOAD(PNUM_FRC, CMD_FRC_SEND, TPerFrcSend_Request)
+DPA_REQUEST_PAYLOAD(PNUM_FRC, CMD_FRC_EXTRARESULT, DpaNoPayload)
+DPA_REQUEST_PAYLOAD(PNUM_FRC, CMD_FRC_SEND_SELECTIVE, TPerFrcSendSelective_Request)
+DPA_REQUEST_PAYLOAD(PNUM_FRC, CMD_FRC_SET_PARAMS, TPerFrcSetParams_RequestResponse)
+
+#undef DPA_REQUEST_PAYLOAD
+
+/// Size of request payload, DpaNoPayload has no PData
+template <typename TPayload>
+struct DpaRequestPayloadSize { static const int value = sizeof(TPayload); };
+
+template <>
+struct DpaRequestPayloadSize<DpaNoPayload> { static const int value = 0; };
+
+/// \class DpaRequest
+/// \brief Prebuilt DPA request with compile time size
+/// \details
+/// The request packet (foursome, HWPID and payload) is prepared once and its length is given by
+/// the payload structure at compile time. Building a DpaMessage is a fixed size copy of the packet
+/// followed by setting of the node address, there is no runtime length computation or validation.
+///
+/// Example:
+/// \code
+/// DpaRequest<PNUM_COORDINATOR, CMD_COORDINATOR_DISCOVERY> discovery;
+/// discovery.Payload().TxPower = 0x07;
+/// discovery.Payload().MaxAddr = 0xfe;
+/// auto dt = dpaHandler->executeDpaTransaction( discovery.Build( COORDINATOR_ADDRESS ), 0 );
+/// \endcode
+template <uint8_t Pnum, uint8_t Pcmd, typename TPayload = typename DpaRequestPayload<Pnum, Pcmd>::Type>
+class DpaRequest
+{
+public:
+  /// Payload type
+  typedef TPayload Payload_t;
+
+  /// Length of the whole request
+  static const int kLength = static_cast<int>(sizeof(TDpaIFaceHeader)) + DpaRequestPayloadSize<TPayload>::value;
+
+  static_assert(kLength <= DpaMessage::kMaxDpaMessageSize, "Payload doesn't fit to DPA message.");
+
+  /// \brief constructor
+  /// \param [in] hwpid HWPID of the request, HWPID_DoNotCheck by default
+  explicit DpaRequest(uint16_t hwpid = HWPID_DoNotCheck)
+  {
+    std::memset(m_packet, 0, sizeof(m_packet));
+    m_packet[kPnumIndex] = Pnum;
+    m_packet[kPcmdIndex] = Pcmd;
+    SetHwpid(hwpid);
+  }
+
+  /// \brief Set HWPID of the request
+  /// \param [in] hwpid HWPID of the request
+  void SetHwpid(uint16_t hwpid)
+  {
+    DpaEndian::storeLe16(m_packet + kHwpidIndex, hwpid);
+  }
+
+  /// \brief Get payload of the request to be filled
+  /// \return reference to payload structure
+  TPayload& Payload()
+  {
+    return *reinterpret_cast<TPayload*>(m_packet + sizeof(TDpaIFaceHeader));
+  }
+
+  const TPayload& Payload() const
+  {
+    return *reinterpret_cast<const TPayload*>(m_packet + sizeof(TDpaIFaceHeader));
+  }
+
+  /// \brief Build request for node
+  /// \param [out] message to be filled
+  /// \param [in] nadr node address
+  void Build(DpaMessage& message, uint16_t nadr) const
+  {
+    std::memcpy(message.DpaPacketData(), m_packet, kLength);
+    message.SetNodeAddress(nadr);
+    message.SetLength<kLength>();
+  }
+
+  /// \brief Build request for node
+  /// \param [in] nadr node address
+  /// \return request message
+  DpaMessage Build(uint16_t nadr) const
+  {
+    DpaMessage message;
+    Build(message, nadr);
+    return message;
+  }
+
+  /// \brief Build variable length request for node
+  /// \param [out] message to be filled
+  /// \param [in] nadr node address
+  /// \param [in] payloadLength number of used bytes of the payload
+  /// \exception std::length_error if the length is negative or bigger than the payload
+  void Build(DpaMessage& message, uint16_t nadr, int payloadLength) const
+  {
+    if (payloadLength < 0 || payloadLength > DpaRequestPayloadSize<TPayload>::value)
+      throw std::length_error("Invalid payload length.");
+
+    const int length = static_cast<int>(sizeof(TDpaIFaceHeader)) + payloadLength;
+    message.AssignData(m_packet, length);
+    message.SetNodeAddress(nadr);
+  }
+
+  /// \brief Build variable length request for node
+  /// \param [in] nadr node address
+  /// \param [in] payloadLength number of used bytes of the payload
+  /// \return request message
+  DpaMessage Build(uint16_t nadr, int payloadLength) const
+  {
+    DpaMessage message;
+    Build(message, nadr, payloadLength);
+    return message;
+  }
+
+private:
+  static const int kPnumIndex = 0x02;
+  static const int kPcmdIndex = 0x03;
+  static const int kHwpidIndex = 0x04;
+
+  uint8_t m_packet[kLength];
+};
@@ -0,0 +1,104 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DpaMessage.h"
+#include "IDpaTransactionResult2.h"
+#include <cstddef>
+#include <stdexcept>
+
+/// \brief Minimal PData length of a response structure from DPA.h
+/// \details
+/// Fixed size structures have to be received whole. Structures with variable tail
+/// (user peripherals bitmap of TPerOSRead_Response and TEnumPeripheralsAnswer) are specialized.
+template <typename TResponse>
+struct DpaResponseMinLength { static const int value = sizeof(TResponse); };
+
+template <>
+struct DpaResponseMinLength<TPerOSRead_Response> { static const int value = offsetof(TPerOSRead_Response, UserPer); };
+
+template <>
+struct DpaResponseMinLength<TEnumPeripheralsAnswer> { static const int value = offsetof(TEnumPeripheralsAnswer, UserPer); };
+
+/// \class DpaResponseView
+/// \brief Typed read-only view of DPA response data
+/// \details
+/// Decodes the PData of a response as the response structure from DPA.h (TPerOSRead_Response,
+/// TPerNodeRead_Response, TPerFrcSend_Response, TPerCoordinatorDiscovery_Response, TEnumPeripheralsAnswer, ...).
+/// The length of received data is checked against the structure, the data are not copied.
+/// The view refers to the response message so the message (transaction result) has to outlive the view.
+///
+/// Example:
+/// \code
+/// std::unique_ptr<IDpaTransactionResult2> res = dt->get();
+/// DpaResponseView<TPerOSRead_Response> osRead( *res );
+/// uint8_t osVersion = osRead->OsVersion;
+/// \endcode
+template <typename TResponse>
+class DpaResponseView
+{
+public:
+  /// Response structure type
+  typedef TResponse Response_t;
+
+  /// \brief Decode response message
+  /// \param [in] response received response
+  /// \exception std::logic_error the message is not a response
+  /// \exception std::length_error the response data are shorter than the structure
+  explicit DpaResponseView(const DpaMessage& response)
+  {
+    if (response.MessageDirection() != DpaMessage::kResponse)
+      throw std::logic_error("Message is not a response.");
+
+    m_dataLength = response.GetLength() - kDataIndex;
+    if (m_dataLength < DpaResponseMinLength<TResponse>::value)
+      throw std::length_error("Response data too short.");
+
+    m_data = reinterpret_cast<const TResponse*>(response.DpaPacketData() + kDataIndex);
+  }
+
+  /// \brief Decode response of transaction
+  /// \param [in] result transaction result
+  /// \exception std::logic_error the transaction has no response
+  /// \exception std::length_error the response data are shorter than the structure
+  explicit DpaResponseView(const IDpaTransactionResult2& result)
+    : DpaResponseView(checkResponded(result).getResponse())
+  {}
+
+  /// \brief Get decoded structure
+  const TResponse& operator*() const { return *m_data; }
+  const TResponse* operator->() const { return m_data; }
+
+  /// \brief Get length of received PData
+  /// \return PData length, can be bigger than minimal length for variable structures
+  int DataLength() const { return m_dataLength; }
+
+private:
+  /// index of PData in response message (foursome + HWPID + ResponseCode + DpaValue)
+  static const int kDataIndex = sizeof(TDpaIFaceHeader) + 2;
+
+  static const IDpaTransactionResult2& checkResponded(const IDpaTransactionResult2& result)
+  {
+    if (!result.isResponded())
+      throw std::logic_error("Transaction has no response.");
+    return result;
+  }
+
+  const TResponse* m_data;
+  int m_dataLength;
+};
@@ -19,9 +19,15 @@
 
 #include "DpaMessage.h"
 #include "IDpaTransaction2.h"
+#include "IDpaPreparedTransaction.h"
+#include "IDpaTransactionGroup.h"
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 class IDpaHandler2
 {
@@ -41,9 +47,131 @@ public:
   typedef std::function<void( const DpaMessage& dpaMessage )> AsyncMessageHandlerFunc;
   /// Any DPA message handler functional type
   typedef std::function<void(const DpaMessage& dpaMessage)> AnyMessageHandlerFunc;
+
+  /// Counters of received messages by the way they were handled
+  struct ReceiveStats {
+    /// all received messages
+    uint64_t received = 0;
+    /// messages longer than DPA buffer
+    uint64_t tooLong = 0;
+    /// asynchronous requests and responses
+    uint64_t asynchronous = 0;
+    /// confirmations and responses processed by pending transaction
+    uint64_t matched = 0;
+    /// confirmations and responses without pending transaction
+    uint64_t noPendingTransaction = 0;
+    /// confirmations and responses received after the transaction finished
+    uint64_t afterFinish = 0;
+    /// messages not being confirmation or response
+    uint64_t notResponse = 0;
+    /// different node address than in pending transaction
+    uint64_t nodeAddressMismatch = 0;
+    /// different peripheral type than in pending transaction
+    uint64_t peripheralTypeMismatch = 0;
+    /// different peripheral command than in pending transaction
+    uint64_t peripheralCommandMismatch = 0;
+  };
+
+  /// Learned confirmation to response time of a node or of a hop count
+  struct TimeoutStats {
+    /// number of recorded transactions
+    uint32_t count = 0;
+    /// exponentially weighted moving average
+    int32_t ewmaMs = 0;
+    /// 95th percentile of recent transactions
+    int32_t p95Ms = 0;
+    /// last recorded time
+    int32_t lastMs = 0;
+    /// number of transactions timed out after confirmation
+    uint32_t timeouts = 0;
+    /// the last recorded transaction timed out
+    bool lastTimedOut = false;
+  };
+
+  /// Number of consecutive timeouts of a node after which it is considered unreachable
+  static const int UNREACHABLE_TIMEOUTS = 3;
+
+  /// Retry of failed transaction
+  struct RetryPolicy {
+    /// number of attempts including the first one, 1 disables retry
+    int maxAttempts = 1;
+    /// delay before the first retry, it doubles with each next retry up to maxBackoffMs
+    int32_t backoffMs = 100;
+    int32_t maxBackoffMs = 5000;
+    /// error codes to be retried, empty means TRN_ERROR_TIMEOUT and TRN_ERROR_IFACE_BUSY
+    std::vector<int> retryOn;
+    /// retry is queued at the head of queue instead of its end, except while a chain with keepInterface runs its steps
+    /// (see executeDpaChain())
+    bool requeueAtHead = false;
+  };
+
+  /// Options of transaction
+  struct TransactionOptions {
+    /// 0 > timeout - use default, 0 == timeout - use infinit, 0 < timeout - user value
+    int32_t timeout = -1;
+    /// error code enforced at the beginning of the transaction, TRN_OK to execute it
+    IDpaTransactionResult2::ErrorCode defaultError = IDpaTransactionResult2::TRN_OK;
+    /// optional observer of transaction stages
+    IDpaTransaction2::ProgressFunc onProgress;
+    /// absolute time until the request has to be sent, time_point::max() for no deadline.
+    /// The transaction finishes with TRN_ERROR_IFACE_BUSY without sending the request if it doesn't start in time.
+    /// It is rejected the same way at once if the predicted duration of the queued transactions exceeds the deadline.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    /// identification of service issuing the transaction used by cancelDpaTransactions()
+    std::string serviceId;
+    /// retry of failed transaction. Retries are skipped while the node is unreachable and if they can't start
+    /// until the deadline. Progress is reported for each attempt. cancelDpaTransactions() cancels queued attempts and retries
+    /// waiting for backoff, a cancelled retry isn't attempted again.
+    RetryPolicy retry;
+  };
+
+  /// Continuation of transaction chain, it builds the next request from the result of the previous step.
+  /// It returns false to end the chain.
+  typedef std::function<bool( const IDpaTransactionResult2& result, DpaMessage& next )> ContinuationFunc;
+  /// Completion handler of asynchronous transaction, gets ownership of the result
+  typedef std::function<void( std::unique_ptr<IDpaTransactionResult2> result )> CompletionFunc;
+  /// Executor of completion handlers, it runs the task inline or passes it to a thread pool
+  typedef std::function<void( std::function<void()> task )> CompletionExecutorFunc;
   /// 0 > timeout - use default, 0 == timeout - use infinit, 0 < timeout - user value
   virtual std::shared_ptr<IDpaTransaction2> executeDpaTransaction( const DpaMessage& request, int32_t timeout,
     IDpaTransactionResult2::ErrorCode defaultError = IDpaTransactionResult2::TRN_OK) = 0;
+  /// Asynchronous variant of executeDpaTransaction(), onCompletion is called by completion executor
+  /// when the transaction finishes. The returned transaction can be used to abort(), its get() returns nullptr
+  /// as the result is passed to onCompletion.
+  virtual std::shared_ptr<IDpaTransaction2> executeDpaTransactionAsync( const DpaMessage& request, int32_t timeout,
+    CompletionFunc onCompletion, IDpaTransactionResult2::ErrorCode defaultError = IDpaTransactionResult2::TRN_OK ) = 0;
+  /// Variant of executeDpaTransaction() with options
+  virtual std::shared_ptr<IDpaTransaction2> executeDpaTransaction( const DpaMessage& request, const TransactionOptions& options ) = 0;
+  /// Variant of executeDpaTransactionAsync() with options
+  virtual std::shared_ptr<IDpaTransaction2> executeDpaTransactionAsync( const DpaMessage& request, const TransactionOptions& options,
+    CompletionFunc onCompletion ) = 0;
+  /// Execute chain of dependent transactions starting with the first request. The continuation is called with the result
+  /// of each step by the handler queue thread, so it must not block. With keepInterface the next step is executed before
+  /// other queued transactions, retries with RetryPolicy::requeueAtHead are queued at the end until the chain finishes.
+  /// Retry policy is not applied to the steps. get() of the returned transaction gives the result of the last step,
+  /// abort() stops the chain as well as cancelDpaTransactions() cancelling a step.
+  virtual std::shared_ptr<IDpaTransaction2> executeDpaChain( const DpaMessage& first, ContinuationFunc continuation,
+    const TransactionOptions& options, bool keepInterface ) = 0;
+  /// Execute requests together, they are queued in order under single queue lock. The batch is checked against
+  /// the queue length limit as a single submission. Completion executor is not used, results are taken from the group.
+  virtual std::shared_ptr<IDpaTransactionGroup> executeDpaTransactions( const std::vector<DpaMessage>& requests,
+    const TransactionOptions& options ) = 0;
+  /// Prepare request executed repeatedly with different node addresses, see IDpaPreparedTransaction.
+  /// Throws std::invalid_argument for empty request.
+  virtual std::shared_ptr<IDpaPreparedTransaction> prepareDpaTransaction( const DpaMessage& request, const TransactionOptions& options ) = 0;
+  /// Abort queued transactions of a service, they are removed from the queue and finish with TRN_ERROR_ABORTED
+  /// without sending. Retries waiting for backoff are aborted as well. The pending transaction is not affected.
+  /// Returns number of aborted transactions.
+  virtual int cancelDpaTransactions( const std::string& serviceId ) = 0;
+  /// Abort queued transactions addressed to a node, see cancelDpaTransactions( serviceId )
+  virtual int cancelDpaTransactions( uint16_t nadr ) = 0;
+  /// Check if a node responds, it is unreachable after UNREACHABLE_TIMEOUTS consecutive timeouts until it responds again
+  virtual bool isNodeReachable( uint16_t nadr ) const = 0;
+  /// Set executor of completion handlers, nullptr runs them inline in the transaction queue thread (default).
+  /// Timers never run completions, the completion of a transaction expired at its deadline is passed to the executor
+  /// at once or, without executor, run by the queue thread when it reaches the transaction. Without executor abort()
+  /// and cancelDpaTransactions() run the completions of the transactions they stop in the calling thread.
+  virtual void setCompletionExecutor( CompletionExecutorFunc executor ) = 0;
   virtual int getTimeout() const = 0;
   virtual void setTimeout( int timeout ) = 0;
   virtual IDpaTransaction2::RfMode getRfCommunicationMode() const = 0;
@@ -57,6 +185,29 @@ public:
   virtual int getDpaQueueLen() const = 0;
   virtual void registerAnyMessageHandler(const std::string& serviceId, AnyMessageHandlerFunc fun) = 0;
   virtual void unregisterAnyMessageHandler(const std::string& serviceId) = 0;
+  /// Get counters of received messages
+  virtual ReceiveStats getReceiveStats() const = 0;
+  /// Use learned confirmation to response times instead of the formulas (disabled by default).
+  /// The times are learned regardless of this setting, the admission control predicts with them only if enabled.
+  virtual void setAdaptiveTimeout( bool enable ) = 0;
+  virtual bool getAdaptiveTimeout() const = 0;
+  /// Get learned confirmation to response times per node address
+  virtual std::map<uint16_t, TimeoutStats> getNodeTimeoutStats() const = 0;
+  /// Get learned confirmation to response times per hop count of request
+  virtual std::map<uint8_t, TimeoutStats> getHopsTimeoutStats() const = 0;
+  /// Forget learned confirmation to response times
+  virtual void resetTimeoutStats() = 0;
+  /// Pass the result of a node transaction to get() or completion as soon as the response arrives (disabled by default).
+  /// The next request is still held back until the expected duration after the response elapses.
+  /// Node transactions are then not executed inline (see setInlineExecution()), the calling thread would wait for it.
+  virtual void setReleaseResultOnResponse( bool enable ) = 0;
+  virtual bool getReleaseResultOnResponse() const = 0;
+  /// Execute synchronous transaction by the thread calling executeDpaTransaction() if no transaction is queued or pending
+  /// (disabled by default). The call then returns the finished transaction and get() doesn't block. Other transactions
+  /// are queued after it, so the order of submissions is kept. Node transactions are queued if setReleaseResultOnResponse()
+  /// is enabled.
+  virtual void setInlineExecution( bool enable ) = 0;
+  virtual bool getInlineExecution() const = 0;
 
   virtual ~IDpaHandler2() {}
 };
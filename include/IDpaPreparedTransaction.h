@@ -0,0 +1,55 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#pragma once
+
+#include "IDpaTransaction2.h"
+#include "IDpaTransactionResult2.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/// \class IDpaPreparedTransaction
+/// \brief Prepared DPA request executed repeatedly
+/// \details
+/// The request is checked and its timeout is classified once by IDpaHandler2::prepareDpaTransaction().
+/// Each execution just patches the node address and optionally PData of the request and queues it,
+/// analogous to a prepared statement. The handle can be used concurrently and it must not outlive
+/// the handler.
+class IDpaPreparedTransaction
+{
+public:
+  /// Completion handler of asynchronous execution, gets ownership of the result
+  typedef std::function<void( std::unique_ptr<IDpaTransactionResult2> result )> CompletionFunc;
+
+  /// \brief Execute the request addressed to a node
+  /// \param [in] nadr node address
+  /// \param [in] pdata PData replacing the prepared ones or nullptr to keep them
+  /// \param [in] length PData length, it has to be equal to the length of the prepared PData
+  /// \return queued transaction
+  virtual std::shared_ptr<IDpaTransaction2> execute( uint16_t nadr, const uint8_t* pdata = nullptr, int length = 0 ) = 0;
+
+  /// \brief Asynchronous variant of execute(), see IDpaHandler2::executeDpaTransactionAsync()
+  virtual std::shared_ptr<IDpaTransaction2> executeAsync( uint16_t nadr, CompletionFunc onCompletion,
+    const uint8_t* pdata = nullptr, int length = 0 ) = 0;
+
+  /// \return prepared request
+  virtual const DpaMessage& getRequest() const = 0;
+
+  virtual ~IDpaPreparedTransaction() {}
+};
@@ -18,6 +18,9 @@
 #pragma once
 
 #include "IDpaTransactionResult2.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -49,6 +52,39 @@ public:
     uint16_t dpaVersion;
   };
 
+  /// stages of transaction lifecycle reported to progress observer
+  enum class Stage {
+    /// transaction was queued
+    kQueued,
+    /// request was sent to coordinator
+    kSent,
+    /// confirmation was received
+    kConfirmed,
+    /// response was received
+    kResponded,
+    /// transaction finished, result is available
+    kFinished
+  };
+
+  /// progress event of transaction
+  struct ProgressEvent
+  {
+    Stage stage;
+    std::chrono::time_point<std::chrono::system_clock> ts;
+    /// values from TIFaceConfirmation, valid since kConfirmed
+    uint8_t hops;
+    uint8_t timeslotLength;
+    uint8_t hopsResponse;
+    /// airtime of the transaction estimated from confirmation in ms, valid since kConfirmed
+    int32_t estimatedTimeMs;
+    /// error code of the result, valid for kFinished
+    int errorCode;
+  };
+
+  /// progress observer, called out of the transaction lock by the thread progressing the transaction.
+  /// It must not block, kFinished can come shortly after get() returned the result.
+  typedef std::function<void( const ProgressEvent& event )> ProgressFunc;
+
   // Timing constants
   /// Default timeout
   static const int DEFAULT_TIMEOUT = 500;
@@ -64,6 +100,6 @@ public:
   virtual ~IDpaTransaction2() {}
   /// wait for result
   virtual std::unique_ptr<IDpaTransactionResult2> get() = 0;
-  /// abort the transaction immediately 
+  /// abort the transaction immediately, no effect after the result is released
   virtual void abort() = 0;
 };
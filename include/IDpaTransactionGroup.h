@@ -0,0 +1,56 @@
+/**
+* Copyright 2015-2018 MICRORISC s.r.o.
+* Copyright 2018 IQRF Tech s.r.o.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#pragma once
+
+#include "IDpaTransactionResult2.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/// \class IDpaTransactionGroup
+/// \brief Transactions submitted together by IDpaHandler2::executeDpaTransactions()
+/// \details
+/// Results are indexed by the order of the requests. Each result is taken just once, either by waitAny()
+/// or by waitAll(). Iteration over the results as they complete:
+/// \code
+/// int index;
+/// while ( std::unique_ptr<IDpaTransactionResult2> result = group->waitAny( index ) ) {
+///   process( index, *result );
+/// }
+/// \endcode
+class IDpaTransactionGroup
+{
+public:
+  /// \return number of transactions in the group
+  virtual size_t size() const = 0;
+
+  /// \brief Wait for all transactions
+  /// \return results in order of the requests, results already taken by waitAny() are nullptr
+  virtual std::vector<std::unique_ptr<IDpaTransactionResult2>> waitAll() = 0;
+
+  /// \brief Wait for any transaction not taken yet
+  /// \param [out] index index of the request or -1 if all results are taken
+  /// \return result of the first completed transaction not taken yet, nullptr if all results are taken
+  virtual std::unique_ptr<IDpaTransactionResult2> waitAny( int& index ) = 0;
+
+  /// \brief Abort all transactions of the group, queued ones are not sent
+  virtual void abort() = 0;
+
+  virtual ~IDpaTransactionGroup() {}
+};
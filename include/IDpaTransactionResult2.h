@@ -66,7 +66,10 @@ public:
   virtual bool isResponded() const = 0;
   virtual ~IDpaTransactionResult2() {};
 
-  static std::string errorCode(int errorCode)
+  /// \brief Get name of error code without allocation
+  /// \param [in] errorCode error code
+  /// \return name of the error code or nullptr for user error codes
+  static const char* errorCodeName(int errorCode)
   {
     switch (errorCode) {
 
@@ -114,10 +117,19 @@ public:
       return "STATUS_CONFIRMATION";
     case TRN_ERROR_USER_FROM:
     default:
-      std::ostringstream os;
-      os << "TRN_ERROR_USER_" << std::hex << errorCode;
-      return os.str();
+      return nullptr;
+    }
+  }
+
+  static std::string errorCode(int errorCode)
+  {
+    const char* name = errorCodeName(errorCode);
+    if (name != nullptr) {
+      return name;
     }
+    std::ostringstream os;
+    os << "TRN_ERROR_USER_" << std::hex << errorCode;
+    return os.str();
   }
 
 };
@@ -0,0 +1,265 @@
+/**
+ * Copyright 2015-2018 MICRORISC s.r.o.
+ * Copyright 2018 IQRF Tech s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "DpaEndian.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "DPA.h"
+#ifdef __cplusplus
+}
+#endif
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+/// \class NodeSet
+/// \brief Set of IQMESH node addresses
+/// \details
+/// Value type of 240 bits node bitmap as used by DPA (SelectedNodes of TPerFrcSendSelective_Request
+/// and TPerOSSelectiveBatch_Request, bonded and discovered devices of CMD_COORDINATOR_BONDED_DEVICES
+/// and CMD_COORDINATOR_DISCOVERED_DEVICES). Node N is bit N % 8 of byte N / 8 of the bitmap.
+/// The bitmap is kept in 64 bit words so set operations, population count and iteration
+/// over set nodes work by words instead of bytes.
+class NodeSet
+{
+public:
+  /// number of addresses in the set
+  static const int MAX_NODES = MAX_ADDRESS + 1;
+  /// length of DPA bitmap field
+  static const int BITMAP_LENGTH = MAX_NODES / 8;
+
+  /// \class const_iterator
+  /// \brief Forward iterator over addresses of set nodes in ascending order
+  class const_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef int value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const int* pointer;
+    typedef int reference;
+
+    const_iterator() : m_set(nullptr), m_word(WORDS), m_bits(0) {}
+    int operator*() const { return m_word * 64 + countTrailingZeros(m_bits); }
+    const_iterator& operator++() { m_bits &= m_bits - 1; skipEmpty(); return *this; }
+    const_iterator operator++(int) { const_iterator it = *this; ++*this; return it; }
+    bool operator==(const const_iterator& other) const { return m_word == other.m_word && m_bits == other.m_bits; }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+  private:
+    friend class NodeSet;
+    const_iterator(const NodeSet* set, int word) : m_set(set), m_word(word), m_bits(word < WORDS ? set->m_words[word] : 0) { skipEmpty(); }
+    void skipEmpty() {
+      while (m_bits == 0 && ++m_word < WORDS) {
+        m_bits = m_set->m_words[m_word];
+      }
+      if (m_word >= WORDS) {
+        m_word = WORDS;
+        m_bits = 0;
+      }
+    }
+    const NodeSet* m_set;
+    int m_word;
+    uint64_t m_bits;
+  };
+
+  /// Empty set
+  NodeSet() { clear(); }
+
+  /// \brief Create set from DPA bitmap
+  /// \param [in] bitmap DPA bitmap
+  /// \param [in] length bitmap length, bits above MAX_ADDRESS are ignored (e.g. 32 bytes of bonded devices)
+  /// \return set of nodes
+  static NodeSet fromBitmap(const uint8_t* bitmap, int length = BITMAP_LENGTH)
+  {
+    NodeSet set;
+    int len = length < BITMAP_LENGTH ? length : BITMAP_LENGTH;
+    if (len <= 0) {
+      return set;
+    }
+    uint8_t padded[WORDS * 8] = { 0 };
+    std::memcpy(padded, bitmap, len);
+    for (int w = 0; w < WORDS; w++) {
+      set.m_words[w] = DpaEndian::loadLe64(padded + w * 8);
+    }
+    return set;
+  }
+
+  /// \brief Store set to DPA bitmap
+  /// \param [out] bitmap DPA bitmap of BITMAP_LENGTH bytes
+  void toBitmap(uint8_t* bitmap) const
+  {
+    uint8_t padded[WORDS * 8];
+    for (int w = 0; w < WORDS; w++) {
+      DpaEndian::storeLe64(padded + w * 8, m_words[w]);
+    }
+    std::memcpy(bitmap, padded, BITMAP_LENGTH);
+  }
+
+  /// \brief Test node
+  /// \param [in] node node address
+  /// \return true if node is in set, false if not or the address is out of range
+  bool test(int node) const
+  {
+    return node >= 0 && node < MAX_NODES && ((m_words[node / 64] >> (node % 64)) & 1) != 0;
+  }
+
+  /// \brief Add or remove node, address out of range is ignored
+  void set(int node, bool value = true)
+  {
+    if (node < 0 || node >= MAX_NODES) {
+      return;
+    }
+    if (value) {
+      m_words[node / 64] |= static_cast<uint64_t>(1) << (node % 64);
+    }
+    else {
+      m_words[node / 64] &= ~(static_cast<uint64_t>(1) << (node % 64));
+    }
+  }
+
+  /// \brief Remove node
+  void reset(int node) { set(node, false); }
+
+  /// \brief Remove all nodes
+  void clear() { std::memset(m_words, 0, sizeof(m_words)); }
+
+  /// \brief Check empty set
+  bool empty() const { return (m_words[0] | m_words[1] | m_words[2] | m_words[3]) == 0; }
+
+  /// \brief Get number of nodes in set
+  int count() const
+  {
+    return popCount(m_words[0]) + popCount(m_words[1]) + popCount(m_words[2]) + popCount(m_words[3]);
+  }
+
+  /// \brief Get the lowest node address in set
+  /// \return node address or -1 if the set is empty
+  int first() const
+  {
+    const_iterator it = begin();
+    return it != end() ? *it : -1;
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(); }
+
+  /// \brief Call function for each node in set in ascending order
+  /// \param [in] fun function called with node address
+  template <typename Func>
+  void forEach(Func fun) const
+  {
+    for (int w = 0; w < WORDS; w++) {
+      for (uint64_t bits = m_words[w]; bits != 0; bits &= bits - 1) {
+        fun(w * 64 + countTrailingZeros(bits));
+      }
+    }
+  }
+
+  /// \brief Split set to chunks
+  /// \param [in] chunkSize maximal number of nodes in chunk
+  /// \return chunks with ascending node addresses, all but the last one have chunkSize nodes
+  std::vector<NodeSet> split(int chunkSize) const
+  {
+    std::vector<NodeSet> chunks;
+    if (chunkSize <= 0) {
+      return chunks;
+    }
+    int n = 0;
+    forEach([&](int node) {
+      if (n++ % chunkSize == 0) {
+        chunks.push_back(NodeSet());
+      }
+      chunks.back().set(node);
+    });
+    return chunks;
+  }
+
+  NodeSet& operator|=(const NodeSet& other)
+  {
+    for (int w = 0; w < WORDS; w++) m_words[w] |= other.m_words[w];
+    return *this;
+  }
+
+  NodeSet& operator&=(const NodeSet& other)
+  {
+    for (int w = 0; w < WORDS; w++) m_words[w] &= other.m_words[w];
+    return *this;
+  }
+
+  /// \brief Remove nodes of other set
+  NodeSet& andNot(const NodeSet& other)
+  {
+    for (int w = 0; w < WORDS; w++) m_words[w] &= ~other.m_words[w];
+    return *this;
+  }
+
+  friend NodeSet operator|(NodeSet a, const NodeSet& b) { return a |= b; }
+  friend NodeSet operator&(NodeSet a, const NodeSet& b) { return a &= b; }
+  friend NodeSet andNot(NodeSet a, const NodeSet& b) { return a.andNot(b); }
+
+  bool operator==(const NodeSet& other) const { return std::memcmp(m_words, other.m_words, sizeof(m_words)) == 0; }
+  bool operator!=(const NodeSet& other) const { return !(*this == other); }
+
+private:
+  static const int WORDS = 4;
+
+  static int popCount(uint64_t x)
+  {
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  /// x must not be 0
+  static int countTrailingZeros(uint64_t x)
+  {
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_ctzll(x);
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<int>(index);
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+      x >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+  /// bits of addresses 0 - 255, bits above MAX_ADDRESS are always 0
+  uint64_t m_words[WORDS];
+};
@@ -21,7 +21,9 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
-#include <queue>
+#include <iterator>
+#include <list>
+#include <vector>
 
 /// \class TaskQueue
 /// \brief Maintain queue of tasks and invoke sequential processing
@@ -71,11 +73,29 @@ public:
   /// Pushes task to queue to be processed in worker thread. The task type T has to be copyable
   /// as the copy is pushed to queue container
   int pushToQueue(const T& task)
+  {
+    return push(task, false);
+  }
+
+  /// \brief Push tasks to queue
+  /// \param [in] tasks objects to push to queue in order
+  /// \return size of queue
+  /// \details
+  /// All tasks are pushed under single lock and the worker thread is notified once.
+  int pushToQueue(const std::vector<T>& tasks)
   {
     int retval = 0;
     {
       std::unique_lock<std::mutex> lck(m_taskQueueMutex);
-      m_taskQueue.push(task);
+      for (const T& task : tasks) {
+        if (!m_spareNodes.empty()) {
+          m_spareNodes.front() = task;
+          m_taskQueue.splice(m_taskQueue.end(), m_spareNodes, m_spareNodes.begin());
+        }
+        else {
+          m_taskQueue.push_back(task);
+        }
+      }
       retval = (int)m_taskQueue.size();
       m_taskPushed = true;
     }
@@ -83,6 +103,65 @@ public:
     return retval;
   }
 
+  /// \brief Push task to the head of queue
+  /// \param [in] task object to push to queue
+  /// \return size of queue
+  /// \details
+  /// The task is processed before the tasks already queued.
+  int pushToQueueFront(const T& task)
+  {
+    return push(task, true);
+  }
+
+  /// \brief Remove tasks from queue
+  /// \param [in] pred selects the tasks to be removed
+  /// \return removed tasks in queue order
+  /// \details
+  /// The predicate is called with the queue locked, so it must not use the queue.
+  std::vector<T> removeFromQueue(std::function<bool(const T&)> pred)
+  {
+    std::vector<T> removed;
+    std::unique_lock<std::mutex> lck(m_taskQueueMutex);
+    for (auto it = m_taskQueue.begin(); it != m_taskQueue.end();) {
+      auto next = std::next(it);
+      if (pred(*it)) {
+        removed.push_back(std::move(*it));
+        m_spareNodes.splice(m_spareNodes.begin(), m_taskQueue, it);
+      }
+      it = next;
+    }
+    return removed;
+  }
+
+  /// \brief Post function to be run by worker thread
+  /// \param [in] func function to run
+  /// \details
+  /// Posted functions are run in order before the next queued task. They are not counted to the queue size
+  /// and removeFromQueue() doesn't see them. Functions posted after stopQueue() are not run. The list nodes
+  /// are reused, so posting a function small enough for std::function's local storage doesn't allocate.
+  void post(std::function<void()> func)
+  {
+    {
+      std::unique_lock<std::mutex> lck(m_taskQueueMutex);
+      if (!m_sparePosted.empty()) {
+        //reuse node of already run function, no allocation
+        m_sparePosted.front() = std::move(func);
+        m_posted.splice(m_posted.end(), m_sparePosted, m_sparePosted.begin());
+      }
+      else {
+        m_posted.push_back(std::move(func));
+      }
+      m_taskPushed = true;
+    }
+    m_conditionVariable.notify_all();
+  }
+
+  /// \brief Check if the caller is the worker thread
+  bool isWorkerThread() const
+  {
+    return std::this_thread::get_id() == m_workerThread.get_id();
+  }
+
   /// \brief Stop queue
   /// \details
   /// Worker thread is explicitly stopped
@@ -109,6 +188,27 @@ public:
   }
 
 private:
+  int push(const T& task, bool front)
+  {
+    int retval = 0;
+    {
+      std::unique_lock<std::mutex> lck(m_taskQueueMutex);
+      auto position = front ? m_taskQueue.begin() : m_taskQueue.end();
+      if (!m_spareNodes.empty()) {
+        //reuse node of already processed task, no allocation
+        m_spareNodes.front() = task;
+        m_taskQueue.splice(position, m_spareNodes, m_spareNodes.begin());
+      }
+      else {
+        m_taskQueue.insert(position, task);
+      }
+      retval = (int)m_taskQueue.size();
+      m_taskPushed = true;
+    }
+    m_conditionVariable.notify_all();
+    return retval;
+  }
+
   /// Worker thread function
   void worker()
   {
@@ -123,9 +223,16 @@ private:
       m_taskPushed = false;
 
       while (m_runWorkerThread) {
-        if (!m_taskQueue.empty()) {
-          auto task = m_taskQueue.front();
-          m_taskQueue.pop();
+        if (!m_posted.empty()) {
+          std::function<void()> func = std::move(m_posted.front());
+          m_posted.front() = nullptr;
+          m_sparePosted.splice(m_sparePosted.begin(), m_posted, m_posted.begin());
+          lck.unlock();
+          func();
+        }
+        else if (!m_taskQueue.empty()) {
+          auto task = std::move(m_taskQueue.front());
+          m_spareNodes.splice(m_spareNodes.begin(), m_taskQueue, m_taskQueue.begin());
           lck.unlock();
           m_processTaskFunc(task);
         }
@@ -140,7 +247,12 @@ private:
 
   std::mutex m_taskQueueMutex;
   std::condition_variable m_conditionVariable;
-  std::queue<T> m_taskQueue;
+  std::list<T> m_taskQueue;
+  //nodes of processed tasks kept for reuse by pushToQueue
+  std::list<T> m_spareNodes;
+  //functions posted to worker thread, see post(), and nodes of run functions kept for reuse
+  std::list<std::function<void()>> m_posted;
+  std::list<std::function<void()>> m_sparePosted;
   bool m_taskPushed;
   bool m_runWorkerThread;
   std::thread m_workerThread;